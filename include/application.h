@@ -5,6 +5,7 @@
 
 #include "http_client.hpp"
 #include "platform/worker.hpp"
+#include "platform/mpmc_queue.hpp"
 #include "platform/platform_http_client.hpp" // For createPlatformHttpClient()
 #include "widget/log_widget.h"
 #include "layout/Layout.h"
@@ -37,6 +38,8 @@ public:
     static Application* getInstance() { return s_instance; }
 
     void runOnMainThread(std::function<void()> task);
+    // Opens connections to these hosts in the background so the first requests find them warm
+    void preconnect(const std::vector<std::string>& urls);
 
 protected:
     // Platform-specific implementations (to be overridden by platform classes)
@@ -68,11 +71,12 @@ protected:
 
     Page m_currentPage; // Current active page
     std::string m_httpGetResponse; // To store HTTP GET response
+    std::shared_ptr<HttpCancelToken> m_httpGetCancel; // Request in flight on the demo page, if any
     std::string m_statusBarMessage; // To store status bar messages
 
 protected:
-    std::queue<std::function<void()>> m_mainThreadTasks;
-    std::mutex m_mainThreadMutex;
+    // Lock-free, so a producer preempted mid-push can't stall the render thread
+    MpmcQueue<std::function<void()>> m_mainThreadTasks;
 public:
     void processMainThreadTasks();
 
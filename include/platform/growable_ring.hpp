@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// FIFO queue on a growable ring buffer. Unlike std::deque it keeps its slots when
+// items are popped, so once a queue has reached its working size, pushing and
+// popping allocate nothing. T must be default-constructible and move-assignable.
+template <typename T>
+class GrowableRing {
+public:
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    void pushBack(T value) {
+        if (m_size == m_slots.size()) {
+            grow();
+        }
+        m_slots[(m_head + m_size) % m_slots.size()] = std::move(value);
+        m_size++;
+    }
+
+    T popFront() {
+        T value = std::move(m_slots[m_head]);
+        m_head = (m_head + 1) % m_slots.size();
+        m_size--;
+        return value;
+    }
+
+private:
+    void grow() {
+        std::vector<T> slots(m_slots.empty() ? 16 : m_slots.size() * 2);
+        for (size_t i = 0; i < m_size; i++) {
+            slots[i] = std::move(m_slots[(m_head + i) % m_slots.size()]);
+        }
+        m_slots = std::move(slots);
+        m_head = 0;
+    }
+
+    std::vector<T> m_slots;
+    size_t m_head = 0;
+    size_t m_size = 0;
+};
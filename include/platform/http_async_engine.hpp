@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "platform/http_client.hpp"
+
+class HttpConnectionPool;
+class HttpLatencyTracker;
+class HttpTransfer;
+typedef void CURLM;
+
+// Event-driven transfer engine: runs many requests concurrently on a single
+// curl_multi handle driven by its own I/O thread. Retries with backoff and
+// hedged duplicates are scheduled on the same thread with timers, so waiting
+// for a retry never occupies a caller's thread.
+//
+// At most getMaxActive() requests run at once, not counting long-lived streams.
+// Beyond that, Normal requests wait ahead of Prefetch ones, while Interactive
+// requests always start right away.
+class HttpAsyncEngine {
+public:
+    // Invoked on the I/O thread once the request has finished or failed.
+    using Completion = std::function<void(HttpResult result)>;
+
+    // Completed transfers are recorded in `latency`, which also drives the hedge delay.
+    HttpAsyncEngine(HttpConnectionPool& pool, HttpLatencyTracker& latency);
+    // Stops the I/O thread; requests still queued or in flight fail with an error.
+    ~HttpAsyncEngine();
+
+    HttpAsyncEngine(const HttpAsyncEngine&) = delete;
+    HttpAsyncEngine& operator=(const HttpAsyncEngine&) = delete;
+
+    void submit(HttpRequest request, Completion onComplete);
+    // The future rethrows transfer errors as std::runtime_error.
+    std::future<HttpResponse> submit(HttpRequest request);
+
+    // Policy used by requests that don't carry their own
+    void setDefaultPolicy(const HttpRetryPolicy& policy);
+    HttpRetryPolicy getDefaultPolicy() const;
+
+    void setMaxActive(size_t maxActive) { m_maxActive = std::max<size_t>(maxActive, 1); }
+    size_t getMaxActive() const { return m_maxActive.load(); }
+
+    size_t getActiveCount() const { return m_activeCount.load(); }
+    // Requests waiting for a free slot
+    size_t getQueuedCount() const { return m_queuedCount.load(); }
+    uint64_t getRetryCount() const { return m_retries.load(); }
+    uint64_t getHedgeCount() const { return m_hedges.load(); }
+    uint64_t getHedgeWinCount() const { return m_hedgeWins.load(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct InFlight {
+        std::unique_ptr<HttpTransfer> transfer;
+        bool hedge;
+    };
+
+    struct Job {
+        HttpRequest request;
+        Completion onComplete;
+        HttpRetryPolicy policy;
+        std::string host;
+        Clock::time_point started;
+        int attempts = 0;
+        bool replayable = true; // May be sent again by a retry or a hedge
+        std::vector<InFlight> inFlight; // The current attempt and its hedge, if any
+    };
+
+    enum class TimerKind { Retry, Hedge };
+    struct Timer {
+        Job* job;
+        TimerKind kind;
+    };
+
+    void threadLoop();
+    void startPending();
+    // Starts waiting requests in priority order while there is room
+    void admitWaiting();
+    // Finishes or drops every request whose cancel token has fired
+    void sweepCancelled();
+    void startAttempt(Job* job);
+    // Returns false if the job had to be finished instead (deadline reached or setup failure)
+    bool startTransfer(Job* job, bool hedge);
+    void onTransferDone(void* handle, int code);
+    void runDueTimers();
+    long pollTimeoutMs() const;
+    void finishJob(Job* job, HttpResult result);
+    static void notify(Job& job, HttpResult result);
+    void removeTransfers(Job* job);
+    void cancelTimers(Job* job);
+    void failAll(const std::string& error);
+
+    // Hedge delay from the host's latency histogram, or zero if there is not enough history yet
+    std::chrono::milliseconds hedgeDelay(const Job& job) const;
+
+    HttpConnectionPool& m_pool;
+    HttpLatencyTracker& m_latency;
+    CURLM* m_multi;
+
+    std::deque<std::unique_ptr<Job>> m_pending;
+    HttpRetryPolicy m_defaultPolicy;
+    mutable std::mutex m_mutex; // Guards m_pending and m_defaultPolicy
+
+    // I/O thread only
+    std::deque<std::unique_ptr<Job>> m_waiting[3]; // Indexed by HttpPriority
+    std::unordered_map<Job*, std::unique_ptr<Job>> m_jobs;
+    std::map<void*, Job*> m_active; // Keyed by easy handle
+    std::multimap<Clock::time_point, Timer> m_timers;
+    std::mt19937 m_rng;
+    size_t m_cancellable; // Requests with a cancel token, as of the last sweep
+    size_t m_longLived;   // Jobs in m_jobs that don't count against the cap
+
+    std::atomic<size_t> m_maxActive;
+    std::atomic<size_t> m_activeCount;
+    std::atomic<size_t> m_queuedCount;
+    std::atomic<uint64_t> m_retries;
+    std::atomic<uint64_t> m_hedges;
+    std::atomic<uint64_t> m_hedgeWins;
+    std::atomic<bool> m_running;
+    std::thread m_ioThread;
+};
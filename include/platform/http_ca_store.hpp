@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <curl/curl.h>
+
+typedef struct x509_store_st X509_STORE;
+
+// Trust store built once from the CA bundle compiled into the binary
+// (cacert_pem_data.hpp) and shared by every TLS connection, instead of having
+// OpenSSL read and parse a cacert.pem file for each new connection.
+class HttpCaStore {
+public:
+    static HttpCaStore& getInstance();
+
+    // Makes the handle verify peers against the embedded bundle.
+    void apply(CURL* handle);
+
+    // Trusts additional certificates (PEM), e.g. a private CA or a test server's
+    // self-signed certificate. Applies to connections opened from now on.
+    // Returns the number of certificates added.
+    size_t addCertificates(std::string_view pem);
+
+    size_t getCertificateCount() const { return m_certificateCount.load(); }
+
+private:
+    HttpCaStore();
+    ~HttpCaStore();
+    HttpCaStore(const HttpCaStore&) = delete;
+    HttpCaStore& operator=(const HttpCaStore&) = delete;
+
+    static CURLcode sslContextCallback(CURL* handle, void* sslContext, void* userptr);
+
+    X509_STORE* m_store;
+    std::atomic<size_t> m_certificateCount; // Added to from any thread; X509_STORE locks itself
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "platform/http_client.hpp"
+
+struct HttpCacheStats {
+    uint64_t hits;            // Served from cache without touching the network
+    uint64_t misses;          // Full downloads
+    uint64_t revalidations;   // Conditional requests sent for stale entries
+    uint64_t notModified;     // Revalidations answered with 304
+    uint64_t bytesSaved;      // Wire (possibly compressed) body bytes not downloaded thanks to hits and 304s
+};
+
+// IHttpClient decorator caching GET responses in a size-bounded in-memory LRU
+// backed by a persistent directory. Freshness follows Cache-Control (no-store,
+// no-cache, max-age) and Expires; stale entries carrying an ETag or Last-Modified
+// are revalidated with If-None-Match / If-Modified-Since, so an unchanged resource
+// only costs a 304 and its headers.
+//
+// Entries are keyed by makeRequestKey() of the URL, query parameters and request
+// headers, as for request coalescing; on disk each is a pair of files named after
+// the SHA-256 of that key, which also records the full key to catch collisions. The Vary response header is ignored: requests that differ
+// only in headers the application didn't pass in share one entry.
+class CachingHttpClient : public IHttpClient {
+public:
+    // An empty cacheDir selects <StateManager internal data path>/http_cache.
+    CachingHttpClient(IHttpClient& inner,
+                      const std::string& cacheDir = "",
+                      size_t maxMemoryBytes = 8 * 1024 * 1024,
+                      size_t maxDiskBytes = 64 * 1024 * 1024);
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override;
+    // Plain GETs go through get(); anything else is passed to the inner client untouched.
+    HttpResponse request(const HttpRequest& request) override;
+
+    HttpCacheStats getStats() const;
+    // Drops every cached entry, in memory and on disk.
+    void clear();
+
+private:
+    struct Entry {
+        std::string key;
+        HttpResponse response;
+        std::string etag;
+        std::string lastModified;
+        std::time_t expiresAt;
+        bool mustRevalidate;
+    };
+
+    // Fills freshness and validators from the response headers. Returns false if the response must not be stored.
+    static bool applyCachePolicy(Entry& entry, std::time_t now);
+
+    bool lookup(const std::string& key, Entry& entry);
+    void store(const Entry& entry);
+    void storeInMemory(const Entry& entry);
+    void remove(const std::string& key);
+    bool loadFromDisk(const std::string& key, Entry& entry);
+    void saveToDisk(const Entry& entry);
+    void pruneDisk();
+    std::string entryPath(const std::string& key) const;
+
+    IHttpClient& m_inner;
+    std::string m_cacheDir;
+    size_t m_maxMemoryBytes;
+    size_t m_maxDiskBytes;
+    size_t m_diskBytes;
+
+    std::list<Entry> m_lru; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    size_t m_memoryBytes;
+    std::mutex m_mutex;
+    std::mutex m_diskMutex;
+
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_revalidations;
+    std::atomic<uint64_t> m_notModified;
+    std::atomic<uint64_t> m_bytesSaved;
+};
@@ -1,10 +1,145 @@
 #pragma once
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <map>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <mutex>
+#include "platform/http_connection_pool.hpp"
+#include "platform/http_headers.hpp"
+#include "platform/http_retry_policy.hpp"
+#include "platform/http_share.hpp"
+
+// Where the time of a transfer went, from CURLINFO_*_TIME_T. Each phase is measured
+// from the start of the transfer, so e.g. the TLS handshake took app_connect - connect.
+struct HttpTiming {
+    std::chrono::microseconds name_lookup{0};    // DNS resolved
+    std::chrono::microseconds connect{0};        // TCP connected
+    std::chrono::microseconds app_connect{0};    // TLS handshake done (0 for plain HTTP)
+    std::chrono::microseconds pre_transfer{0};   // About to send the request
+    std::chrono::microseconds start_transfer{0}; // First response byte received
+    std::chrono::microseconds total{0};
+    size_t bytes_uploaded = 0;
+    size_t bytes_downloaded = 0;   // Body bytes as received, like HttpResponse::wire_bytes
+    bool connection_reused = false; // No new connection had to be opened
+};
 
 struct HttpResponse {
-    int status_code;
+    int status_code = 0;
     std::string text;
+    HttpHeaders headers; // Final response only, looked up case-insensitively
+    // Body size as received (possibly compressed) and after Content-Encoding was decoded.
+    // Both count bytes handed to a sink as well, and are equal for uncompressed responses.
+    size_t wire_bytes = 0;
+    size_t decoded_bytes = 0;
+    HttpTiming timing;
+};
+
+// Receives the response body chunk by chunk. Returning false cancels the transfer.
+// A sink may block to apply backpressure when the transfer runs on the caller's
+// thread (HttpClient::getStream); sinks given to the async engine must not block.
+using HttpChunkSink = std::function<bool(std::string_view chunk)>;
+
+// Sees the final status and headers once, right before the first body byte. Returning
+// false drops the body and ends the transfer as a sink returning false would, so an
+// error page never reaches the sink. Same threading rules as a sink.
+using HttpResponseCheck = std::function<bool(int status, const HttpHeaders& headers)>;
+
+// Request body. Nothing is copied into an intermediate buffer: curl reads `data`
+// in place, pulls from `reader` or reads `filePath` from disk as it sends.
+// Set at most one of the three.
+struct HttpRequestBody {
+    std::string_view data; // Must stay valid until the request has completed
+    // Fills up to `size` bytes of `buffer` and returns the count; 0 ends the body.
+    // Runs on the transfer's thread and, like a sink, must not block on the async engine.
+    std::function<size_t(char* buffer, size_t size)> reader;
+    std::string filePath;
+    int64_t length = -1; // Size of a reader body if known; -1 sends it chunked
+
+    bool empty() const { return data.empty() && !reader && filePath.empty(); }
+};
+
+// One part of a multipart/form-data body: either in-memory data (not copied)
+// or a file streamed from disk.
+struct HttpFormPart {
+    std::string name;
+    std::string_view data; // Must stay valid until the request has completed
+    std::string filePath;
+    std::string fileName;    // Defaults to the base name of filePath
+    std::string contentType; // Defaults to curl's guess from the file name
+};
+
+// Start order when the engine's active request cap is reached. Interactive requests
+// (a user is waiting on them) bypass the cap; queued prefetches go after everything else.
+enum class HttpPriority { Interactive, Normal, Prefetch };
+
+// Cancels requests from any thread, e.g. when the user navigates away. One token
+// may be shared by any number of requests. A cancelled request that is queued never
+// starts; one in flight is aborted from curl's progress callback. Either way it
+// fails with "Request cancelled".
+class HttpCancelToken {
+public:
+    void cancel() { m_cancelled.store(true); }
+    bool isCancelled() const { return m_cancelled.load(); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+struct HttpRequest {
+    std::string method = "GET";
+    std::string url;
+    std::map<std::string, std::string> params;
+    std::map<std::string, std::string> headers;
+    HttpChunkSink sink; // When set, the body goes here instead of HttpResponse::text
+    HttpResponseCheck checkResponse; // Optional; not called for responses without a body
+    std::optional<HttpRetryPolicy> retryPolicy; // Overrides HttpClient's policy for this request
+    // Advertise every Content-Encoding curl can decode and decode the body transparently.
+    // Turn off for byte ranges, which must address the identity representation.
+    bool acceptCompressed = true;
+    HttpRequestBody body;
+    std::vector<HttpFormPart> form; // Sent as multipart/form-data instead of body when not empty
+    HttpPriority priority = HttpPriority::Normal;
+    std::shared_ptr<HttpCancelToken> cancelToken; // Null: the request can't be cancelled
+    // Streams that stay open indefinitely (event streams, long polls) don't count
+    // against the engine's active request cap, so they can't starve other requests
+    bool longLived = false;
+
+    // Sending it twice has the same effect as sending it once (everything but POST and PATCH)
+    bool isIdempotent() const;
+    // Nothing beyond what IHttpClient::get() can express: lets decorators route it through get()
+    bool isPlainGet() const;
+};
+
+// Outcome of a request that reports errors instead of throwing them
+struct HttpResult {
+    HttpResponse response;
+    std::string error; // Empty on success
+    bool ok() const { return error.empty(); }
+};
+
+struct HttpBatchOptions {
+    size_t maxParallel = 8;  // Transfers in flight across all hosts
+    size_t maxPerHost = 4;   // Transfers in flight per scheme://host:port
+    // Called on the thread running getBatch() after each completed request
+    std::function<void(size_t completed, size_t total)> onProgress;
+    // Same thread, with the index of the request that just finished and its result
+    std::function<void(size_t index, const HttpResult& result)> onResult;
+};
+
+struct HttpPreconnectResult {
+    std::string origin; // "scheme://host:port"
+    std::string error;  // Empty when the connection was established
+    // What the warm-up paid so the first real request doesn't: name_lookup, connect and
+    // app_connect (TLS) are the interesting phases, total includes the HEAD round trip
+    HttpTiming timing;
+    bool ok() const { return error.empty(); }
 };
 
 class IHttpClient {
@@ -13,16 +148,100 @@ public:
     virtual HttpResponse get(const std::string& url,
                              const std::map<std::string, std::string>& params,
                              const std::map<std::string, std::string>& headers) = 0;
+    // Any method, with an optional body or multipart form.
+    virtual HttpResponse request(const HttpRequest& request) = 0;
 };
 
+class HttpAsyncEngine;
+class HttpLatencyTracker;
+
 class HttpClient : public IHttpClient {
 public:
     HttpClient();
     ~HttpClient();
+
+    // Blocking wrapper around getAsync(). Throws std::runtime_error on transfer errors.
     HttpResponse get(const std::string& url,
                      const std::map<std::string, std::string>& params,
                      const std::map<std::string, std::string>& headers) override;
 
+    // Blocking wrapper around requestAsync(). Uses the same engine, connection pool and
+    // TLS settings as get(). Throws std::runtime_error on transfer errors.
+    HttpResponse request(const HttpRequest& request) override;
+
+    // Non-blocking GET executed on the shared curl_multi I/O thread
+    std::future<HttpResponse> getAsync(const std::string& url,
+                                       const std::map<std::string, std::string>& params,
+                                       const std::map<std::string, std::string>& headers,
+                                       std::shared_ptr<HttpCancelToken> cancelToken = nullptr);
+    // Non-blocking request of any method, e.g. with a body, a priority or its own retry policy
+    std::future<HttpResponse> requestAsync(HttpRequest request);
+    // Same, reporting the result through the main thread dispatcher
+    void requestAsync(HttpRequest request, std::function<void(HttpResult)> onComplete);
+    // GET that reports the result through the main thread dispatcher
+    void getAsync(const std::string& url,
+                  const std::map<std::string, std::string>& params,
+                  const std::map<std::string, std::string>& headers,
+                  std::function<void(HttpResult)> onComplete,
+                  std::shared_ptr<HttpCancelToken> cancelToken = nullptr);
+
+    // Blocking GET that streams the body into the sink on the calling thread instead
+    // of buffering it. The returned response has an empty text. A sink returning false
+    // ends the transfer early without an error. Throws std::runtime_error on transfer
+    // errors and cancellation.
+    HttpResponse getStream(const std::string& url,
+                           const std::map<std::string, std::string>& params,
+                           const std::map<std::string, std::string>& headers,
+                           HttpChunkSink sink,
+                           std::shared_ptr<HttpCancelToken> cancelToken = nullptr);
+
+    // Runs all requests on the async engine with bounded concurrency and blocks until
+    // they are done. Results are in input order; failures are reported per request
+    // through HttpResult::error instead of being thrown.
+    std::vector<HttpResult> getBatch(std::vector<HttpRequest> requests,
+                                     const HttpBatchOptions& options = HttpBatchOptions());
+
+    // Warms up connections in the background: resolves, connects and TLS-handshakes each
+    // distinct origin of `urls` with a HEAD of its root at Prefetch priority. The open
+    // connections stay in the engine's connection cache and the DNS entries and TLS
+    // sessions land in the shared caches, so the first real request to those hosts
+    // skips the setup. Whatever the status, the connection is
+    // kept. Each result and the total time are logged; the future is optional.
+    std::future<std::vector<HttpPreconnectResult>> preconnect(const std::vector<std::string>& urls);
+
+    // Where getAsync() callbacks run. Application routes them through runOnMainThread;
+    // without a dispatcher they run directly on the I/O thread.
+    void setMainThreadDispatcher(std::function<void(std::function<void()>)> dispatcher);
+    // Runs the task through the dispatcher, or right away on this thread without one
+    void dispatchToMainThread(std::function<void()> task);
+
+    // Default retry/backoff/hedging policy for requests that don't carry their own
+    void setRetryPolicy(const HttpRetryPolicy& policy);
+    HttpRetryPolicy getRetryPolicy() const;
+    uint64_t getRetryCount() const;       // Attempts started after a retryable failure
+    uint64_t getHedgeCount() const;       // Duplicate transfers started by hedging
+    uint64_t getHedgeWinCount() const;    // Hedged requests answered by the duplicate
+
+    // Requests started at once by the engine before Normal and Prefetch ones queue
+    void setMaxActiveRequests(size_t maxActive);
+    size_t getQueuedRequestCount() const;
+
+    // Connection pool tuning and statistics
+    void setMaxConnectionsPerHost(size_t maxPerHost) { m_pool.setMaxPerHost(maxPerHost); }
+    void setConnectionIdleTimeout(std::chrono::seconds timeout) { m_pool.setIdleTimeout(timeout); }
+    uint64_t getPoolHits() const { return m_pool.getHits(); }
+    uint64_t getPoolMisses() const { return m_pool.getMisses(); }
+    // The DNS/TLS session share, for handles driven outside the engine (HttpWebSocket)
+    CURLSH* getShareHandle() const { return m_share.handle(); }
+
+    // Rolling per-host latency histograms of every completed transfer
+    HttpLatencyTracker& getLatencyTracker() { return *m_latency; }
+
 private:
-    std::string m_caBundlePath;
-};
\ No newline at end of file
+    HttpShare m_share; // Declared before the pool: pooled handles must be closed before the share
+    HttpConnectionPool m_pool;
+    std::unique_ptr<HttpLatencyTracker> m_latency;
+    std::function<void(std::function<void()>)> m_dispatcher;
+    std::mutex m_dispatcherMutex;
+    std::unique_ptr<HttpAsyncEngine> m_engine; // Declared last: stopped before the pool goes away
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "platform/http_client.hpp"
+
+struct HttpCoalescingStats {
+    uint64_t transfers;  // Requests that actually went to the inner client
+    uint64_t coalesced;  // Callers that joined a transfer already in flight
+    size_t maxWaiters;   // Largest number of joined callers seen on a single transfer
+};
+
+// IHttpClient decorator performing single-flight GETs: concurrent callers asking
+// for the same normalized request (URL, params and headers) share one transfer
+// and all receive the same HttpResponse, or the same exception.
+class CoalescingHttpClient : public IHttpClient {
+public:
+    explicit CoalescingHttpClient(IHttpClient& inner);
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override;
+    // Plain GETs go through get(); anything else is passed to the inner client untouched.
+    HttpResponse request(const HttpRequest& request) override;
+
+    HttpCoalescingStats getStats() const;
+    // Joined callers currently waiting, per in-flight request key
+    std::map<std::string, size_t> getWaiterCounts();
+
+    // makeRequestKey(): equivalent requests map to the same key, different ones never do
+    static std::string makeKey(const std::string& url,
+                               const std::map<std::string, std::string>& params,
+                               const std::map<std::string, std::string>& headers);
+
+private:
+    struct Flight {
+        std::shared_future<HttpResponse> result;
+        size_t waiters; // Joined callers that haven't returned yet, guarded by m_mutex
+    };
+
+    IHttpClient& m_inner;
+    std::map<std::string, std::shared_ptr<Flight>> m_inFlight;
+    mutable std::mutex m_mutex;
+    std::atomic<uint64_t> m_transfers;
+    std::atomic<uint64_t> m_coalesced;
+    size_t m_maxWaiters; // Guarded by m_mutex
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef void CURL;
+typedef void CURLSH;
+
+// Pool of keep-alive CURL easy handles keyed by "scheme://host:port".
+// A handle keeps its live connections, DNS cache and TLS session cache between
+// transfers, so reusing it skips the DNS/TCP/TLS setup for the same origin. With a
+// share object set, those caches are common to all handles instead.
+class HttpConnectionPool {
+public:
+    HttpConnectionPool(size_t maxPerHost = 4,
+                       std::chrono::seconds idleTimeout = std::chrono::seconds(60));
+    ~HttpConnectionPool();
+
+    HttpConnectionPool(const HttpConnectionPool&) = delete;
+    HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+    // Returns an idle handle for the given key, or a fresh one if none is pooled.
+    // The handle is reset to default options. Throws std::runtime_error on failure.
+    CURL* acquire(const std::string& key);
+    // Gives a handle back to the pool. Handles beyond the per-host limit are closed.
+    void release(const std::string& key, CURL* handle);
+    // Closes handles that have been idle for longer than the idle timeout.
+    void evictIdle();
+
+    // Attaches every handle handed out from now on to the given curl share object.
+    // The share must outlive the pool.
+    void setShare(CURLSH* share);
+    void setMaxPerHost(size_t maxPerHost);
+    void setIdleTimeout(std::chrono::seconds idleTimeout);
+
+    uint64_t getHits() const { return m_hits.load(); }
+    uint64_t getMisses() const { return m_misses.load(); }
+    uint64_t getEvictions() const { return m_evictions.load(); }
+    size_t getIdleCount();
+
+    // Builds the pool key ("scheme://host:port") for a URL.
+    static std::string makeKey(const std::string& url);
+
+private:
+    struct IdleHandle {
+        CURL* handle;
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    void evictIdleLocked(std::chrono::steady_clock::time_point now);
+
+    std::map<std::string, std::vector<IdleHandle>> m_idle;
+    std::mutex m_mutex;
+    CURLSH* m_share;
+    size_t m_maxPerHost;
+    std::chrono::seconds m_idleTimeout;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_evictions;
+};
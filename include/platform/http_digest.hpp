@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Lower-case hex SHA-256, for names and keys that must match across builds and
+// platforms, which std::hash doesn't guarantee. Both throw std::runtime_error on failure.
+std::string sha256Hex(std::string_view data);
+// Reads the file in 1 MiB blocks
+std::string sha256FileHex(const std::string& path);
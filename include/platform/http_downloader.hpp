@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include "platform/http_client.hpp"
+
+struct HttpDownloadOptions {
+    size_t parallelSegments = 4;            // Range requests in flight at once
+    uint64_t segmentSize = 4 * 1024 * 1024; // Unit of work and of resume
+    std::map<std::string, std::string> headers;
+    int64_t expectedLength = -1;  // Checked against the server's length when >= 0
+    std::string expectedSha256;   // Hex digest, checked once the file is complete when set
+    int maxAttempts = 3;          // Passes over the segments that are still missing
+    std::chrono::milliseconds segmentTimeout{120000};
+    HttpPriority priority = HttpPriority::Normal;  // Prefetch for downloads nobody is waiting on
+    std::shared_ptr<HttpCancelToken> cancelToken; // Stops the download; completed segments stay journaled
+    // Called on the thread running download() as bytes are committed to disk
+    std::function<void(uint64_t done, uint64_t total)> onProgress;
+};
+
+struct HttpDownloadResult {
+    uint64_t length = 0;
+    uint64_t resumedBytes = 0; // Already on disk from an interrupted earlier run
+    size_t segments = 0;       // Segments fetched by this run
+    bool ranged = false;       // False when the server doesn't serve ranges and the body was streamed
+    std::string sha256;        // Only computed when an expected digest was given
+};
+
+// Downloads a URL straight to disk. When the server answers a HEAD with a length
+// and "Accept-Ranges: bytes", the file is split into segments that are fetched in
+// parallel with Range requests and written in place into a preallocated
+// "<path>.part". "<path>.part.json" records the completed segments after their
+// data is flushed, so a later download() of the same URL and path only fetches
+// what is missing. An ETag or Last-Modified is sent back as If-Range, which makes
+// a resource that changed in between restart from scratch instead of mixing versions.
+//
+// Servers without range support get a single streamed GET, which can't resume. So do
+// servers that advertise ranges but answer them with 200 and offer no validator.
+class HttpDownloader {
+public:
+    explicit HttpDownloader(HttpClient& client);
+
+    // Blocks until the file is complete and verified, then moves it to `path`.
+    // Throws std::runtime_error on failure. Partial data and the journal are kept
+    // for the next attempt unless the length or checksum turned out to be wrong.
+    HttpDownloadResult download(const std::string& url,
+                                const std::string& path,
+                                const HttpDownloadOptions& options = HttpDownloadOptions());
+
+private:
+    struct Probe {
+        int64_t length = -1;
+        bool acceptsRanges = false;
+        std::string validator; // Strong ETag, or else Last-Modified; empty if neither
+    };
+
+    Probe probe(const std::string& url, const HttpDownloadOptions& options);
+    HttpDownloadResult downloadRanged(const std::string& url, const std::string& partPath,
+                                      const Probe& probe, const HttpDownloadOptions& options);
+    HttpDownloadResult downloadStreamed(const std::string& url, const std::string& partPath,
+                                        const HttpDownloadOptions& options);
+
+    HttpClient& m_client;
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "platform/http_client.hpp"
+
+enum class HttpEventStreamFormat {
+    ServerSentEvents, // text/event-stream
+    NdJson            // One JSON value per line (application/x-ndjson)
+};
+
+struct HttpStreamEvent {
+    std::string type = "message"; // SSE "event:" field; "message" for NDJSON
+    std::string data;             // SSE "data:" lines joined with '\n', or the NDJSON line
+    std::string id;               // Last event ID in effect when the event was dispatched
+    nlohmann::json json;          // The parsed line in NDJSON mode; null for SSE
+};
+
+// Incremental text/event-stream or NDJSON parser. Accepts the body in chunks of
+// any size, split anywhere, and calls the handler for every complete event.
+class HttpEventStreamParser {
+public:
+    using EventHandler = std::function<void(HttpStreamEvent&& event)>;
+
+    HttpEventStreamParser(HttpEventStreamFormat format, EventHandler onEvent);
+
+    void write(std::string_view chunk);
+    // Starts a new connection: drops a partial line or event but keeps the last
+    // event ID and the server's reconnection delay, as the SSE spec requires.
+    void reset();
+
+    const std::string& getLastEventId() const { return m_lastEventId; }
+    // From the SSE "retry:" field; zero until the server sends one
+    std::chrono::milliseconds getRetryDelay() const { return m_retry; }
+
+private:
+    void line(std::string_view text);
+    void dispatch();
+
+    HttpEventStreamFormat m_format;
+    EventHandler m_onEvent;
+    std::string m_line;
+    bool m_afterCR;      // A '\r' ended the last line; a '\n' right after it belongs to it
+    bool m_atStart;      // A byte order mark is only skipped at the start of the stream
+    std::string m_type;
+    std::string m_data;
+    bool m_hasData;
+    std::string m_lastEventId;
+    std::chrono::milliseconds m_retry;
+};
+
+struct HttpEventStreamOptions {
+    HttpEventStreamFormat format = HttpEventStreamFormat::ServerSentEvents;
+    std::map<std::string, std::string> headers;
+    // Wait before reconnecting after the stream ends; the server's "retry:" field replaces it
+    std::chrono::milliseconds reconnectDelay{3000};
+    // Failed connections back off exponentially from reconnectDelay up to this
+    std::chrono::milliseconds maxReconnectDelay{60000};
+    // Reconnect when nothing at all arrives for this long; zero disables it.
+    // Servers usually send comment lines as heartbeats well within this.
+    std::chrono::milliseconds idleTimeout{0};
+};
+
+// Long-lived subscription to an event stream that replaces polling. Keeps one
+// request open, parses events as the bytes arrive and reconnects on its own,
+// sending Last-Event-ID so the server can replay what was missed. An HTTP 204
+// answer ends the subscription, as the SSE spec asks. Other non-2xx answers, and
+// SSE answers that aren't text/event-stream, are failed connections whose bodies
+// are never parsed.
+//
+// Events are queued and handed to onEvents through the client's main thread
+// dispatcher. Everything that arrives before the main thread gets to the queue
+// comes as one batch, so a burst of events costs one callback per frame.
+class HttpEventSubscription {
+public:
+    using EventsHandler = std::function<void(std::vector<HttpStreamEvent>&& events)>;
+    using ErrorHandler = std::function<void(const std::string& error)>;
+
+    // Connects right away. onError (optional) also runs on the main thread, once per failed connection.
+    HttpEventSubscription(HttpClient& client,
+                          const std::string& url,
+                          EventsHandler onEvents,
+                          const HttpEventStreamOptions& options = HttpEventStreamOptions(),
+                          ErrorHandler onError = nullptr);
+    // Closes the stream. Batches already handed to the dispatcher are dropped.
+    ~HttpEventSubscription();
+
+    HttpEventSubscription(const HttpEventSubscription&) = delete;
+    HttpEventSubscription& operator=(const HttpEventSubscription&) = delete;
+
+    // Stops reconnecting and aborts the open request. Blocks until the connection thread
+    // exits, except when called from onEvents or onError. The subscription must not be
+    // destroyed from its own handlers when the client has no dispatcher.
+    void close();
+
+    bool isConnected() const { return m_connected.load(); }
+    bool isClosed() const { return m_closed.load(); }
+    uint64_t getEventCount() const { return m_eventCount.load(); }
+    uint64_t getReconnectCount() const { return m_reconnects.load(); }
+    std::string getLastEventId();
+
+private:
+    // State reachable from queued main-thread tasks, which may outlive the subscription
+    struct Delivery {
+        std::mutex mutex;
+        std::vector<HttpStreamEvent> events;
+        bool scheduled = false;
+        bool closed = false;
+        EventsHandler onEvents;
+        ErrorHandler onError;
+    };
+
+    void run();
+    void enqueue(std::vector<HttpStreamEvent>&& events);
+    void reportError(const std::string& error);
+
+    HttpClient& m_client;
+    std::string m_url;
+    HttpEventStreamOptions m_options;
+    std::shared_ptr<Delivery> m_delivery;
+
+    HttpEventStreamParser m_parser; // Fed on the I/O thread, read by run() between connections
+    std::vector<HttpStreamEvent> m_parsed; // Events from the chunk being parsed
+    std::mutex m_parserMutex;              // Guards m_parser and m_parsed
+    std::atomic<int64_t> m_lastActivity; // steady_clock ticks of the last received byte
+    std::atomic<std::thread::id> m_ioThread; // Thread the sink last ran on
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::shared_ptr<HttpCancelToken> m_connection; // Token of the open request, guarded by m_mutex
+    std::atomic<bool> m_closed;
+    std::atomic<bool> m_connected;
+    std::atomic<uint64_t> m_eventCount;
+    std::atomic<uint64_t> m_reconnects;
+    std::thread m_thread;
+};
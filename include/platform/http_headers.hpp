@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Response headers as received: the header block of the final response is kept in one
+// contiguous buffer, and an index of offsets points at each field's name and value.
+// Lookups are case-insensitive and hand out string_views into the buffer, so capturing
+// headers costs two growing allocations per response instead of one map node and two
+// strings per field. The views stay valid until the HttpHeaders is modified or destroyed;
+// copies get their own buffer.
+//
+// Repeated fields (Set-Cookie, Link, Cache-Control) are kept as separate entries in
+// received order: get() returns the first, iterate to see them all.
+class HttpHeaders {
+public:
+    struct Field {
+        std::string_view name;  // As sent by the server, e.g. "Content-Type"
+        std::string_view value; // Without surrounding whitespace
+    };
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Field;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Field;
+
+        Field operator*() const { return m_headers->field(m_index); }
+        Iterator& operator++() { m_index++; return *this; }
+        Iterator operator++(int) { Iterator previous = *this; m_index++; return previous; }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+
+    private:
+        friend class HttpHeaders;
+        Iterator(const HttpHeaders* headers, size_t index) : m_headers(headers), m_index(index) {}
+        const HttpHeaders* m_headers;
+        size_t m_index;
+    };
+
+    // Parses a header block as produced by serialize() or received on the wire
+    static HttpHeaders parse(std::string_view block);
+
+    // Value of the first field called `name`, compared case-insensitively
+    std::optional<std::string_view> find(std::string_view name) const;
+    // Same, with an empty view for a missing field
+    std::string_view get(std::string_view name) const { return find(name).value_or(std::string_view()); }
+    bool contains(std::string_view name) const { return find(name).has_value(); }
+    size_t count(std::string_view name) const;
+
+    size_t size() const { return m_fields.size(); }
+    bool empty() const { return m_fields.empty(); }
+    Field operator[](size_t index) const { return field(index); }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, m_fields.size()); }
+
+    // Takes one line from CURLOPT_HEADERFUNCTION. A status line starts a new response
+    // (after a redirect, 100 Continue or proxy CONNECT) and drops what came before.
+    void addLine(std::string_view line);
+    void add(std::string_view name, std::string_view value);
+    // Replaces the fields that `newer` carries, e.g. a 304 refreshing a cached response
+    void merge(const HttpHeaders& newer);
+    void clear();
+
+    // Status line (if any) and fields as "Name: value\r\n" lines, for persisting
+    const std::string& serialize() const { return m_buffer; }
+    // Bytes held, for cache accounting
+    size_t byteSize() const { return m_buffer.size(); }
+
+    bool operator==(const HttpHeaders& other) const { return m_buffer == other.m_buffer; }
+    bool operator!=(const HttpHeaders& other) const { return !(*this == other); }
+
+private:
+    struct Span {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+
+    Field field(size_t index) const;
+
+    std::string m_buffer;      // Status line and field lines, CRLF terminated
+    size_t m_statusLength = 0; // Leading bytes of m_buffer holding the status line
+    std::vector<Span> m_fields;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "platform/http_client.hpp"
+
+// Log-linear latency histogram in the style of HdrHistogram: exact below 32 µs,
+// then 16 buckets per power of two (at most ~6% relative error) up to about 12 days.
+// Recording is O(1) and the memory use is fixed.
+class HttpLatencyHistogram {
+public:
+    HttpLatencyHistogram();
+
+    void record(std::chrono::microseconds value);
+    void merge(const HttpLatencyHistogram& other);
+    void clear();
+
+    uint64_t getCount() const { return m_count; }
+    std::chrono::microseconds getMin() const;
+    std::chrono::microseconds getMax() const { return std::chrono::microseconds(m_max); }
+    double getMeanMicros() const;
+    // Value below which the given fraction (0..1) of the samples fall
+    std::chrono::microseconds percentile(double fraction) const;
+
+    // Summary percentiles plus the non-empty buckets as [upper bound µs, count] pairs
+    nlohmann::json toJson() const;
+
+private:
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_min;
+    uint64_t m_max;
+    double m_sum;
+};
+
+// Rolling per-host (scheme://host:port) histograms of total request time and
+// time to first byte. The window is split into slots that are recycled as time
+// passes, so queries only reflect the last `window` of traffic. Thread-safe.
+class HttpLatencyTracker {
+public:
+    explicit HttpLatencyTracker(std::chrono::seconds window = std::chrono::seconds(60), size_t slots = 6);
+
+    void record(const std::string& host, const HttpTiming& timing);
+
+    HttpLatencyHistogram getTotal(const std::string& host);
+    HttpLatencyHistogram getTimeToFirstByte(const std::string& host);
+    std::vector<std::string> getHosts();
+
+    // {"<host>": {"total": {...}, "ttfb": {...}}, ...}
+    nlohmann::json toJson();
+
+private:
+    struct Slot {
+        int64_t epoch = -1; // Which slot-length interval since the clock's epoch this slot holds
+        HttpLatencyHistogram total;
+        HttpLatencyHistogram ttfb;
+    };
+
+    int64_t currentEpoch() const;
+    // Merges the slots of a host that are still inside the window
+    void collectLocked(const std::vector<Slot>& slots, int64_t epoch,
+                       HttpLatencyHistogram* total, HttpLatencyHistogram* ttfb) const;
+
+    std::chrono::steady_clock::duration m_slotLength;
+    size_t m_slotCount;
+    std::map<std::string, std::vector<Slot>> m_hosts;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "platform/http_client.hpp"
+
+struct HttpRateLimit {
+    double requestsPerSecond = 10.0; // Token refill rate
+    double burst = 10.0;             // Bucket capacity
+    size_t maxConcurrent = 4;        // Requests in flight at once; 0 means no cap
+    std::chrono::seconds maxRetryAfter{3600}; // Longest pause a Retry-After can impose
+};
+
+struct HttpHostLimiterStats {
+    size_t queueDepth;       // Callers waiting for their turn
+    size_t active;           // Requests currently in flight
+    double tokens;           // Tokens left in the bucket
+    uint64_t requests;       // Requests let through so far
+    uint64_t throttled;      // 429/503 answers received
+    double averageWaitMs;    // Time spent queued, averaged over all requests
+    double maxWaitMs;
+    std::chrono::milliseconds blockedFor; // Remaining Retry-After pause, if any
+};
+
+// IHttpClient decorator keeping a token bucket and a concurrency cap per
+// scheme://host:port. Callers over the limit are queued first come, first served
+// rather than failed. A 429 or 503 empties the bucket, and its Retry-After header
+// pauses the whole host for the requested time, up to maxRetryAfter.
+//
+// Only requests made through this decorator's get() and request() are limited.
+// HttpClient's getAsync(), requestAsync() and getBatch() are not part of IHttpClient
+// and go straight to the engine, so code using them on a rate-limited host has to
+// go through the blocking calls here instead (from a Worker task, say).
+class RateLimitingHttpClient : public IHttpClient {
+public:
+    explicit RateLimitingHttpClient(IHttpClient& inner, const HttpRateLimit& defaultLimit = HttpRateLimit());
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override;
+    HttpResponse request(const HttpRequest& request) override;
+
+    // Limit for one host, given as any URL on it. Other hosts use the default limit.
+    void setHostLimit(const std::string& url, const HttpRateLimit& limit);
+    // Keyed by scheme://host:port
+    std::map<std::string, HttpHostLimiterStats> getStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Host {
+        HttpRateLimit limit;
+        double tokens;
+        Clock::time_point refilledAt;
+        Clock::time_point blockedUntil;
+        uint64_t nextTicket = 0; // FIFO order: a caller may only proceed when its ticket is served
+        uint64_t serving = 0;
+        size_t active = 0;
+        uint64_t requests = 0;
+        uint64_t throttled = 0;
+        double totalWaitMs = 0.0;
+        double maxWaitMs = 0.0;
+        std::condition_variable changed;
+    };
+
+    // Blocks until the host lets this caller through
+    void acquire(const std::string& key);
+    // response is null when the inner client threw
+    void release(const std::string& key, const HttpResponse* response);
+    Host& hostLocked(const std::string& key);
+    static void refill(Host& host, Clock::time_point now);
+
+    template <typename Send>
+    HttpResponse throttle(const std::string& url, Send send);
+
+    IHttpClient& m_inner;
+    HttpRateLimit m_defaultLimit;
+    std::map<std::string, std::unique_ptr<Host>> m_hosts;
+    std::mutex m_mutex;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "platform/http_client.hpp"
+
+// Request/response archives for running UI and pipeline benchmarks offline and
+// repeatably. An archive is the magic "HTTPREC1" followed by one record per
+// exchange: a 4-byte little-endian length and a MessagePack map holding the
+// request key, status, headers, body, timing and, for failed requests, the error.
+// Records are appended as requests complete, so an interrupted recording keeps
+// everything up to the last finished request.
+//
+// Requests are matched on method, normalized URL, params and body; headers are
+// left out because they tend to carry tokens and timestamps that change per run.
+// In-memory and file bodies, form parts included, count by their SHA-256. A reader
+// body can only be consumed once, by the transfer, so it is not part of the key:
+// requests with reader bodies are told apart by method, URL and params alone.
+
+// IHttpClient decorator that passes every request on and appends the exchange
+// to an archive. Streamed bodies are captured on their way to the caller's sink.
+class RecordingHttpClient : public IHttpClient {
+public:
+    // Creates or truncates the archive. Throws std::runtime_error if it can't be written.
+    RecordingHttpClient(IHttpClient& inner, const std::string& path);
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override;
+    HttpResponse request(const HttpRequest& request) override;
+
+    uint64_t getRecordedCount() const { return m_recorded.load(); }
+
+private:
+    void record(const HttpRequest& request, const HttpResponse& response, const std::string& error);
+
+    IHttpClient& m_inner;
+    std::ofstream m_file;
+    std::mutex m_mutex;
+    std::atomic<uint64_t> m_recorded;
+};
+
+enum class HttpReplayPacing {
+    Immediate, // Answer as fast as possible
+    Recorded   // Take as long as the original transfer did (HttpTiming::total)
+};
+
+// IHttpClient serving the responses of an archive without touching the network.
+// Requests recorded several times are answered in recorded order; once those run
+// out the last one repeats. Requests missing from the archive throw, and so do
+// requests that failed when they were recorded, with the original message.
+class ReplayHttpClient : public IHttpClient {
+public:
+    // Loads the whole archive. Throws std::runtime_error if it is missing or corrupt.
+    explicit ReplayHttpClient(const std::string& path, HttpReplayPacing pacing = HttpReplayPacing::Immediate);
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override;
+    HttpResponse request(const HttpRequest& request) override;
+
+    size_t getRecordingCount() const { return m_count; }
+    uint64_t getReplayedCount() const { return m_replayed.load(); }
+    uint64_t getMissCount() const { return m_misses.load(); }
+
+    // Key a request is recorded and looked up under
+    static std::string makeKey(const HttpRequest& request);
+
+private:
+    struct Exchange {
+        HttpResponse response;
+        std::string error;
+    };
+    struct Entry {
+        std::vector<Exchange> exchanges;
+        size_t next = 0;
+    };
+
+    HttpReplayPacing m_pacing;
+    std::map<std::string, Entry> m_entries;
+    size_t m_count;
+    std::mutex m_mutex;
+    std::atomic<uint64_t> m_replayed;
+    std::atomic<uint64_t> m_misses;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+// Key identifying a GET for coalescing, caching and replay. Lower-cases scheme,
+// host and header names, drops default ports and orders params and headers, so
+// equivalent requests map to the same key. Every component is percent-escaped
+// before it is joined, so no name or value can pass for a separator: different
+// requests never share a key.
+std::string makeRequestKey(const std::string& url,
+                           const std::map<std::string, std::string>& params,
+                           const std::map<std::string, std::string>& headers);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <curl/curl.h>
+
+// Retry, backoff and hedging rules for a request. The defaults reproduce a
+// single attempt with a 10 s timeout; set maxAttempts > 1 to enable retries.
+struct HttpRetryPolicy {
+    int maxAttempts = 1;
+    std::set<CURLcode> retryableCurlCodes = {
+        CURLE_COULDNT_RESOLVE_HOST, CURLE_COULDNT_CONNECT, CURLE_OPERATION_TIMEDOUT,
+        CURLE_SSL_CONNECT_ERROR, CURLE_GOT_NOTHING, CURLE_SEND_ERROR, CURLE_RECV_ERROR,
+        CURLE_PARTIAL_FILE, CURLE_HTTP2, CURLE_HTTP2_STREAM
+    };
+    bool retryServerErrors = true;     // 5xx except 501 and 505
+    bool retryTooManyRequests = true;  // 429, honouring Retry-After
+    // A Retry-After longer than maxBackoff is not waited out: the response is returned.
+    // POST and PATCH may have taken effect even when the response was lost, so they
+    // are only retried or hedged when this is set. Streaming reader bodies never are.
+    bool retryNonIdempotent = false;
+
+    // Delay before attempt n+1 is initialBackoff * multiplier^(n-1), capped at maxBackoff,
+    // then reduced by a random fraction of up to `jitter` to spread out synchronized clients.
+    std::chrono::milliseconds initialBackoff{200};
+    std::chrono::milliseconds maxBackoff{5000};
+    double backoffMultiplier = 2.0;
+    double jitter = 0.5;
+
+    std::chrono::milliseconds attemptTimeout{10000};
+    std::chrono::milliseconds totalDeadline{0}; // Covers all attempts and backoff; 0 means none
+
+    // Hedging starts a duplicate transfer when the first one has not answered after
+    // the host's observed latency percentile, and keeps whichever finishes first.
+    // Requests streaming into a sink are never hedged.
+    bool hedge = false;
+    double hedgePercentile = 0.95;
+    std::chrono::milliseconds minHedgeDelay{20};
+
+    bool isRetryable(CURLcode result, int statusCode) const {
+        if (result != CURLE_OK) {
+            return retryableCurlCodes.count(result) > 0;
+        }
+        if (statusCode == 429) {
+            return retryTooManyRequests;
+        }
+        return retryServerErrors && statusCode >= 500 && statusCode != 501 && statusCode != 505;
+    }
+
+    // Backoff before the next attempt, `attempt` being the number of attempts made so far
+    std::chrono::milliseconds backoff(int attempt, std::mt19937& rng) const {
+        double delay = static_cast<double>(initialBackoff.count());
+        for (int i = 1; i < attempt; ++i) {
+            delay *= backoffMultiplier;
+        }
+        delay = std::min(delay, static_cast<double>(maxBackoff.count()));
+        std::uniform_real_distribution<double> spread(0.0, jitter);
+        delay *= 1.0 - spread(rng);
+        return std::chrono::milliseconds(static_cast<long long>(delay));
+    }
+};
+
+// Longest delay parseRetryAfter() returns unless asked for less. Far enough to mean
+// "not any time soon", near enough that now() + delay can't overflow a time_point.
+constexpr std::chrono::seconds kMaxRetryAfter{24 * 3600};
+
+// Delay asked for by a Retry-After header, in either the delta-seconds or the HTTP-date
+// form, clamped to [0, max]. Empty when the value is neither.
+inline std::optional<std::chrono::seconds> parseRetryAfter(std::string_view value,
+                                                           std::chrono::seconds max = kMaxRetryAfter) {
+    long long seconds = 0;
+    const auto parsed = std::from_chars(value.data(), value.data() + value.size(), seconds);
+    if (parsed.ec == std::errc::result_out_of_range) {
+        return max; // All digits, just too many of them
+    }
+    if (parsed.ec != std::errc()) {
+        const std::string date(value);
+        const time_t when = curl_getdate(date.c_str(), nullptr);
+        if (when <= 0) {
+            return std::nullopt;
+        }
+        seconds = static_cast<long long>(when) - static_cast<long long>(std::time(nullptr));
+    }
+    return std::chrono::seconds(std::clamp<long long>(seconds, 0, max.count()));
+}
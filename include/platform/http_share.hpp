@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <curl/curl.h>
+
+// Process-wide curl share object: the DNS cache and TLS session cache are shared
+// by every easy handle attached to it, whichever thread or multi handle drives
+// them. Locking is done with one mutex per data kind. The connection cache is not
+// shared: libcurl does not support using a shared connection cache from threads
+// running concurrently, and the engine's multi handle, getStream() callers and
+// HttpWebSocket do. The engine reuses connections through its own multi handle.
+//
+// TLS sessions can be persisted to a file so that the first connection after a
+// cold start resumes its session instead of doing a full handshake. This needs
+// libcurl >= 8.12 built with SSLS export support; older builds only share in memory.
+// The file is a JSON array with one object per unexpired session: "shmac" (curl's
+// salted hash of the peer, so host names are not stored), "data" (the serialized
+// session, ticket included, hex encoded) and "valid_until" (Unix time, 0 if unknown).
+// A ticket is enough to resume its session, so the file is created owner-only.
+class HttpShare {
+public:
+    // An empty sessionFile disables TLS session persistence.
+    explicit HttpShare(const std::string& sessionFile = "");
+    // Saves the TLS sessions. Every handle attached to the share must be gone by now.
+    ~HttpShare();
+
+    HttpShare(const HttpShare&) = delete;
+    HttpShare& operator=(const HttpShare&) = delete;
+
+    CURLSH* handle() const { return m_share; }
+
+    // Returns the number of sessions imported or exported.
+    size_t loadTlsSessions();
+    size_t saveTlsSessions();
+
+private:
+    static void lockCallback(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlockCallback(CURL* handle, curl_lock_data data, void* userptr);
+
+    CURLSH* m_share;
+    std::string m_sessionFile;
+    std::mutex m_locks[CURL_LOCK_DATA_LAST];
+};
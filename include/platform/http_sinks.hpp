@@ -0,0 +1,156 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "platform/http_client.hpp"
+
+// Ready-made HttpChunkSink implementations. Each sink object must outlive the
+// transfer it is attached to; sink() returns a callable bound to the object.
+
+// Writes the body straight to a file. Cancels the transfer on write errors.
+class HttpFileSink {
+public:
+    // Throws std::runtime_error if the file cannot be opened.
+    explicit HttpFileSink(const std::string& path);
+    ~HttpFileSink();
+
+    HttpFileSink(const HttpFileSink&) = delete;
+    HttpFileSink& operator=(const HttpFileSink&) = delete;
+
+    bool write(std::string_view chunk);
+    // Flushes and closes the file. Returns false if any write failed.
+    bool close();
+
+    size_t getBytesWritten() const { return m_bytesWritten; }
+    HttpChunkSink sink() { return [this](std::string_view chunk) { return write(chunk); }; }
+
+private:
+    std::FILE* m_file;
+    size_t m_bytesWritten;
+    bool m_failed;
+};
+
+// Fixed-capacity byte ring shared between the transfer (producer) and a reader
+// thread. write() blocks while the ring is full, which stalls the socket read and
+// lets TCP flow control push back on the server.
+class HttpRingBufferSink {
+public:
+    explicit HttpRingBufferSink(size_t capacity = 256 * 1024);
+
+    HttpRingBufferSink(const HttpRingBufferSink&) = delete;
+    HttpRingBufferSink& operator=(const HttpRingBufferSink&) = delete;
+
+    // Producer side. Returns false once the reader has cancelled.
+    bool write(std::string_view chunk);
+    // Marks the end of the body; readers drain the remaining bytes and then get 0.
+    void finish();
+
+    // Reader side. Blocks until data is available; returns 0 at end of body or after cancel().
+    size_t read(char* out, size_t maxBytes);
+    // Stops the transfer at its next chunk and wakes any blocked reader or writer.
+    void cancel();
+
+    size_t getCapacity() const { return m_buffer.size(); }
+    HttpChunkSink sink() { return [this](std::string_view chunk) { return write(chunk); }; }
+
+private:
+    std::vector<char> m_buffer;
+    size_t m_head; // Next byte to read
+    size_t m_size; // Bytes currently stored
+    bool m_finished;
+    bool m_cancelled;
+    std::mutex m_mutex;
+    std::condition_variable m_canRead;
+    std::condition_variable m_canWrite;
+};
+
+// Incremental JSON decoder. Emits every complete top-level value as soon as its
+// last byte arrives, which covers newline-delimited JSON and concatenated values.
+// When the body is a single top-level array its elements are emitted one by one,
+// so only the element currently being received is buffered.
+class HttpJsonStreamSink {
+public:
+    // Return false from the handler to cancel the transfer.
+    using ValueHandler = std::function<bool(nlohmann::json&& value)>;
+
+    explicit HttpJsonStreamSink(ValueHandler onValue, bool unwrapTopLevelArray = true);
+
+    bool write(std::string_view chunk);
+    // Flushes a trailing scalar value. Returns false if the body ended mid-value.
+    bool finish();
+
+    const std::string& getError() const { return m_error; }
+    size_t getValueCount() const { return m_valueCount; }
+    HttpChunkSink sink() { return [this](std::string_view chunk) { return write(chunk); }; }
+
+private:
+    bool emit();
+    bool fail(const std::string& error);
+
+    ValueHandler m_onValue;
+    bool m_unwrapTopLevelArray;
+    bool m_sawTopLevelValue;
+    bool m_inTopLevelArray;
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+    std::string m_buffer;
+    std::string m_error;
+    size_t m_valueCount;
+};
+
+// Push-style JSON tokenizer that drives an nlohmann SAX handler straight from the
+// transfer's chunks, so decoding overlaps the download and neither the body nor a
+// DOM is ever held in memory. Only a string, number or literal that is split
+// across chunks is buffered. Several top-level values in a row (newline-delimited
+// JSON) are delivered one after another. Syntax errors are reported through the
+// handler's parse_error() and cancel the transfer, as does returning false from
+// any handler callback.
+class HttpJsonSaxSink {
+public:
+    using Sax = nlohmann::json_sax<nlohmann::json>;
+
+    explicit HttpJsonSaxSink(Sax& handler);
+
+    bool write(std::string_view chunk);
+    // Completes a trailing top-level number. Returns false if the body ended mid-value.
+    bool finish();
+
+    const std::string& getError() const { return m_error; }
+    size_t getValueCount() const { return m_valueCount; }
+    HttpChunkSink sink() { return [this](std::string_view chunk) { return write(chunk); }; }
+
+private:
+    enum class Expect { Value, ValueOrEnd, KeyOrEnd, Key, Colon, CommaOrEnd };
+    enum class Token { None, String, Number, Literal };
+
+    bool structural(char c);
+    bool stringChars(std::string_view chunk, size_t& i);
+    bool endToken();
+    bool endNumber();
+    bool endLiteral();
+    bool endValue();
+    void appendCodePoint(uint32_t codePoint);
+    // Reports a syntax error to the handler; both stop the transfer
+    bool fail(const std::string& error);
+    bool cancel(const std::string& error = "Cancelled by the JSON handler");
+
+    Sax& m_handler;
+    Expect m_expect;
+    Token m_token;
+    bool m_tokenIsKey;
+    std::string m_text;       // Decoded string, or raw number / literal characters
+    int m_escape;             // 0 none, 1 after a backslash, 2-5 reading \u hex digits
+    uint32_t m_unicode;
+    uint32_t m_highSurrogate; // Pending first half of a \u surrogate pair
+    std::vector<char> m_stack; // '{' or '[' per open container
+    size_t m_offset;          // Bytes consumed, for error positions
+    size_t m_valueCount;
+    std::string m_error;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <curl/curl.h>
+#include "platform/http_client.hpp"
+#include "platform/http_connection_pool.hpp"
+
+// A single transfer on a pooled easy handle. Used both by the blocking path
+// (curl_easy_perform) and by the curl_multi engine, so that every request gets
+// the same options whichever way it is driven.
+class HttpTransfer {
+public:
+    // Acquires a handle from the pool and configures it for the request.
+    // Throws std::runtime_error if no handle can be created or an upload file can't be opened.
+    HttpTransfer(HttpConnectionPool& pool, const HttpRequest& request);
+    ~HttpTransfer();
+
+    HttpTransfer(const HttpTransfer&) = delete;
+    HttpTransfer& operator=(const HttpTransfer&) = delete;
+
+    CURL* handle() const { return m_handle; }
+    void setTimeout(std::chrono::milliseconds timeout);
+    // Body bytes handed to the response text or sink so far
+    size_t bodyBytes() const { return m_bodyBytes; }
+
+    // Runs the transfer synchronously on the calling thread.
+    CURLcode perform();
+    // Finalizes the transfer: fills the response and hands the handle back to the
+    // pool when the transfer succeeded (a failed handle is closed instead).
+    void complete(CURLcode result);
+
+    HttpResponse& response() { return m_response; }
+    // True when the request's sink returned false to end the transfer early
+    bool cancelledBySink() const { return m_sinkCancelled; }
+    // True when the request's cancel token has fired
+    bool cancelled() const { return m_cancelToken && m_cancelToken->isCancelled(); }
+    // Error message for a failed transfer, including a sink's or body reader's exception text if any
+    std::string describeFailure(CURLcode result) const;
+
+    static std::string buildUrl(CURL* handle, const std::string& url,
+                                const std::map<std::string, std::string>& params);
+    static std::string describeError(CURLcode result);
+
+private:
+    // In-memory form part read in place by curl
+    struct BodyView {
+        std::string_view data;
+        size_t offset;
+    };
+
+    void setMethodAndBody(const HttpRequest& request);
+    void readTiming();
+    void setForm(const std::vector<HttpFormPart>& form);
+
+    static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* userp);
+    static size_t headerCallback(char* buffer, size_t size, size_t nitems, void* userp);
+    static size_t readCallback(char* buffer, size_t size, size_t nitems, void* userp);
+    static int seekCallback(void* userp, curl_off_t offset, int origin);
+    static size_t viewReadCallback(char* buffer, size_t size, size_t nitems, void* arg);
+    static int viewSeekCallback(void* arg, curl_off_t offset, int origin);
+    static int progressCallback(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+
+    HttpConnectionPool& m_pool;
+    std::string m_poolKey;
+    std::string m_url;
+    CURL* m_handle;
+    struct curl_slist* m_headers;
+    HttpChunkSink m_sink;
+    HttpResponseCheck m_checkResponse;
+    bool m_sinkCancelled;
+    std::shared_ptr<HttpCancelToken> m_cancelToken;
+    size_t m_bodyBytes;
+    std::string m_sinkError;
+    HttpResponse m_response;
+
+    std::FILE* m_uploadFile;
+    std::function<size_t(char*, size_t)> m_reader;
+    std::string m_readerError;
+    curl_mime* m_mime;
+    std::deque<BodyView> m_formViews; // Stable addresses for curl_mime_data_cb
+};
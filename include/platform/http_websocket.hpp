@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "platform/http_client.hpp"
+
+struct HttpWebSocketOptions {
+    std::map<std::string, std::string> headers;
+    std::string protocol; // Sec-WebSocket-Protocol, e.g. "graphql-ws"; empty to send none
+    std::chrono::milliseconds connectTimeout{10000};
+    // A ping goes out when the connection has been quiet this long; zero disables keepalive
+    std::chrono::milliseconds pingInterval{15000};
+    // Reconnect when nothing, not even a pong, arrived this long after the ping
+    std::chrono::milliseconds pongTimeout{10000};
+    // Backoff between reconnection attempts, doubling after each failure
+    std::chrono::milliseconds reconnectDelay{1000};
+    std::chrono::milliseconds maxReconnectDelay{30000};
+    std::chrono::milliseconds sendTimeout{5000}; // How long send() waits for a congested socket
+    size_t maxMessageSize = 16 * 1024 * 1024;    // Larger messages drop the connection
+};
+
+struct HttpWebSocketMessage {
+    std::string_view data;
+    bool binary = false;
+};
+
+// Messages received since the last delivery, stored back to back in one buffer
+// that curl writes into directly. The views are only valid during the callback:
+// the buffer is recycled for the next batch afterwards.
+class HttpWebSocketBatch {
+public:
+    size_t size() const { return m_messages.size(); }
+    bool empty() const { return m_messages.empty(); }
+    HttpWebSocketMessage operator[](size_t index) const {
+        const Entry& entry = m_messages[index];
+        return {std::string_view(m_buffer.data() + entry.offset, entry.length), entry.binary};
+    }
+
+private:
+    friend class HttpWebSocket;
+
+    struct Entry {
+        size_t offset;
+        size_t length;
+        bool binary;
+    };
+
+    // Hands the complete messages to `out` by swapping buffers. Bytes of a message
+    // still being received are the only thing copied, into out's old buffer.
+    void moveCompleteTo(HttpWebSocketBatch& out);
+
+    std::string m_buffer;        // Sized ahead of m_used so curl has room to write
+    size_t m_used = 0;           // Received bytes, including a message in progress
+    size_t m_committed = 0;      // End of the last complete message
+    bool m_partialBinary = false;
+    std::vector<Entry> m_messages;
+};
+
+// WebSocket client on libcurl's ws:// / wss:// support, using the same CA store
+// and DNS/TLS session share as HttpClient. A connection thread owns the socket:
+// it frames and reassembles messages, keeps the connection alive with pings
+// (curl answers the server's pings itself) and reconnects with backoff when the
+// connection drops.
+//
+// Messages are handed to onMessages through the client's main thread dispatcher.
+// At most one delivery is queued at a time, so everything that arrives before
+// the main thread runs it comes as one batch: one callback per frame.
+class HttpWebSocket {
+public:
+    using MessagesHandler = std::function<void(const HttpWebSocketBatch& messages)>;
+    using ErrorHandler = std::function<void(const std::string& error)>;
+
+    // Connects right away. onError (optional) also runs on the main thread, once per lost or failed connection.
+    HttpWebSocket(HttpClient& client,
+                  const std::string& url,
+                  MessagesHandler onMessages,
+                  const HttpWebSocketOptions& options = HttpWebSocketOptions(),
+                  ErrorHandler onError = nullptr);
+    ~HttpWebSocket();
+
+    HttpWebSocket(const HttpWebSocket&) = delete;
+    HttpWebSocket& operator=(const HttpWebSocket&) = delete;
+
+    // Send a message from any thread. Blocks until the frame is handed to the socket.
+    // Returns false while disconnected or if the send fails; nothing is queued.
+    bool send(std::string_view text);
+    bool sendBinary(std::string_view data);
+
+    // Sends a close frame, stops reconnecting and waits for the connection thread, except
+    // when called from onMessages or onError. Batches already handed to the dispatcher are
+    // dropped. The socket must not be destroyed from its own handlers when the client has
+    // no dispatcher.
+    void close();
+
+    bool isConnected() const { return m_connected.load(); }
+    bool isClosed() const { return m_closed.load(); }
+    uint64_t getMessageCount() const { return m_messageCount.load(); }
+    uint64_t getReconnectCount() const { return m_reconnects.load(); }
+
+private:
+    // State reachable from queued main-thread tasks, which may outlive the socket
+    struct Delivery {
+        std::mutex mutex;
+        HttpWebSocketBatch incoming; // Written by the connection thread
+        HttpWebSocketBatch spare;    // Buffer handed back after the last callback
+        bool scheduled = false;
+        bool closed = false;
+        MessagesHandler onMessages;
+        ErrorHandler onError;
+    };
+
+    void run();
+    CURL* connect(std::string& error);
+    // Reads until the socket runs dry. Returns false with `error` set when the connection is gone.
+    bool receive(CURL* handle, std::string& error);
+    bool sendFrame(std::string_view data, unsigned int flags);
+    void schedule();
+    void reportError(const std::string& error);
+
+    HttpClient& m_client;
+    std::string m_url;
+    HttpWebSocketOptions m_options;
+    std::shared_ptr<Delivery> m_delivery;
+
+    CURL* m_handle; // Open connection, guarded by m_handleMutex; null while disconnected
+    std::mutex m_handleMutex;
+    std::chrono::steady_clock::time_point m_lastActivity; // Connection thread only
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_closed;
+    std::atomic<bool> m_connected;
+    std::atomic<uint64_t> m_messageCount;
+    std::atomic<uint64_t> m_reconnects;
+    std::thread m_thread;
+};
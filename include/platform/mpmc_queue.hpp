@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "growable_ring.hpp"
+
+// Multi-producer multi-consumer FIFO queue. The fast path is a bounded lock-free ring
+// (Dmitry Vyukov's design): every cell carries a sequence number that tells producers
+// and consumers whose turn it is, so a push or pop is one CAS on the shared index and
+// nobody holds a lock another thread could be preempted under. When the ring is full,
+// pushes spill into a mutex-guarded overflow ring instead of failing or blocking; it
+// keeps its slots, so a warmed-up queue allocates nothing even after a burst.
+// While anything is in the overflow, pushes go there too, which keeps each producer's
+// items in order; consumers empty the ring before taking from the overflow.
+//
+// Consumers that find the queue empty get false back: parking them is up to the caller.
+// A pop can also come back empty-handed while a concurrent push is half done.
+template <typename T>
+class MpmcQueue {
+public:
+    // Ring capacity, rounded up to a power of two
+    explicit MpmcQueue(size_t capacity = 1024)
+        : m_enqueue(0)
+        , m_dequeue(0)
+        , m_overflowSize(0)
+        , m_overflowCount(0)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = size - 1;
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    void push(T value) {
+        if (m_overflowSize.load(std::memory_order_acquire) == 0 && tryPushRing(value)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_overflowMutex);
+        m_overflow.pushBack(std::move(value));
+        m_overflowSize.fetch_add(1, std::memory_order_release);
+        m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool tryPop(T& value) {
+        if (tryPopRing(value)) {
+            return true;
+        }
+        if (m_overflowSize.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_overflowMutex);
+        if (m_overflow.empty()) {
+            return false;
+        }
+        // Ring items still waiting (e.g. claimed by a push that hasn't published yet) are
+        // older than the overflow's: report empty and let the caller come back for them.
+        // The dequeue index never passes the enqueue index, so reading it first and finding
+        // both equal means the ring was empty at that moment, and no overflow push can
+        // land while we hold the lock.
+        const size_t dequeued = m_dequeue.load(std::memory_order_acquire);
+        if (m_enqueue.load(std::memory_order_acquire) != dequeued) {
+            return false;
+        }
+        value = m_overflow.popFront();
+        m_overflowSize.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+    // Pushes that found the ring full, a hint that the capacity is too small
+    uint64_t getOverflowCount() const { return m_overflowCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    bool tryPushRing(T& value) {
+        size_t position = m_enqueue.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[position & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                // The cell is free for this lap: claim the position, then publish the value
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false; // Still holds the value from the previous lap: full
+            } else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPopRing(T& value) {
+        size_t position = m_dequeue.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[position & m_mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    // Hand the cell to the producer of the next lap
+                    cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false; // Not yet published: empty
+            } else {
+                position = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    // Producers and consumers each hammer their own index; keep them on separate cache lines
+    alignas(64) std::atomic<size_t> m_enqueue;
+    alignas(64) std::atomic<size_t> m_dequeue;
+    alignas(64) std::atomic<size_t> m_overflowSize;
+    std::atomic<uint64_t> m_overflowCount;
+    std::mutex m_overflowMutex;
+    GrowableRing<T> m_overflow;
+};
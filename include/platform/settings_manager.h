@@ -61,6 +61,9 @@ public:
     const std::vector<std::string>& getAvailableFontNames() const { return m_availableFontNames; }
     const std::vector<float>& getAvailableFontSizes() const { return m_availableFontSizes; }
     float getScale() const { return m_currentSettings.scale; }
+    // API origins to warm up at startup: the "settings_preconnect_hosts" state value,
+    // URLs separated by commas or spaces. Empty when unset: nothing is contacted unasked.
+    std::vector<std::string> getPreconnectHosts() const;
 
 private:
     Settings m_currentSettings;
@@ -6,7 +6,7 @@
 
 #include <mutex>
 #include <condition_variable>
-#include "worker.hpp" // For Worker::getInstance().postTask
+#include "worker.hpp" // For Worker::getInstance().postOn
 
 class StateManager {
 public:
@@ -32,6 +32,9 @@ public:
     const std::string& getInternalDataPath() const { return m_internalDataPath; }
     bool isStateLoaded() const { return m_stateLoaded.load(); }
     void resetStateLoaded() { m_stateLoaded.store(false); }
+    // Serial worker queue for loads and saves. Post work that must see the loaded
+    // state, or must not race a save, here too.
+    const Worker::Queue& getQueue() const { return m_queue; }
 
     private:
     StateManager();
@@ -44,6 +47,7 @@ public:
     std::map<std::string, std::string> m_state;
     std::mutex m_mutex;
     std::atomic<bool> m_stateLoaded;
+    Worker::Queue m_queue;
 
     void updateStateFilePath();
     void loadStateInternal(); // Internal synchronous load
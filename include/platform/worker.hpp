@@ -1,32 +1,83 @@
-
 #pragma once
 
+#include <atomic>
 #include <functional>
-#include <queue>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 #include <future> // Required for std::future and std::packaged_task
+#include "mpmc_queue.hpp"
+#include "worker_task.hpp"
 
+// Thread pool for background work. Each thread owns a lock-free queue: tasks posted
+// from a pool thread go to its own queue, tasks posted from anywhere else are dealt
+// out round-robin, and a thread that runs dry steals from the others before parking
+// on a condition variable.
+// Tasks posted with postTask() may run concurrently and in any order; post to a
+// Queue when they must run one at a time in posting order.
+//
+// postTask() hands back a future, which costs a std::function, a packaged_task and
+// their shared state per call. post() is the fire-and-forget path: a small lambda
+// travels inline in a WorkerTask and queueing it allocates nothing. An exception
+// escaping a posted task is logged.
 class Worker {
 public:
+    // Serial queue (strand) on top of the pool: its tasks run one after another in
+    // posting order, on whichever pool thread is free. Copies refer to the same queue.
+    class Queue {
+    public:
+        Queue();
+
+    private:
+        friend class Worker;
+        struct State {
+            std::mutex mutex;
+            WorkerTaskRing tasks;
+            bool scheduled = false; // A drain task is posted to the pool or running
+        };
+        std::shared_ptr<State> m_state;
+    };
+
     static Worker& getInstance();
 
+    // 0 threads means std::thread::hardware_concurrency()
+    explicit Worker(size_t threadCount = 0);
+
     // Delete copy constructor and assignment operator
     Worker(const Worker&) = delete;
     Worker& operator=(const Worker&) = delete;
 
+    // Runs the tasks still queued, then joins the threads
     ~Worker();
 
     std::future<void> postTask(std::function<void()> task);
+    std::future<void> postTaskOn(const Queue& queue, std::function<void()> task);
+    // Both throw std::runtime_error for an empty (default-constructed or moved-from) task
+    void post(WorkerTask task);
+    void postOn(const Queue& queue, WorkerTask task);
+
+    size_t getThreadCount() const { return m_threads.size(); }
+    uint64_t getStealCount() const { return m_steals.load(); }
 
 private:
-    Worker();
-    void threadLoop();
+    struct alignas(64) ThreadQueue {
+        MpmcQueue<WorkerTask> tasks;
+    };
+
+    static void run(WorkerTask& task);
+    bool tryPop(size_t index, WorkerTask& task);
+    void drain(std::shared_ptr<Queue::State> state);
+    void threadLoop(size_t index);
 
-    std::queue<std::packaged_task<void()>> m_tasks;
-    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_nextQueue;
+    std::atomic<size_t> m_pending; // Tasks in, or being pushed to, the thread queues
+    std::atomic<size_t> m_sleeping; // Threads waiting on m_condition
+    std::atomic<uint64_t> m_steals;
+    std::mutex m_mutex;            // Guards sleeping and m_running
     std::condition_variable m_condition;
-    std::thread m_workerThread;
     bool m_running;
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "growable_ring.hpp"
+
+// Move-only void() callable for the Worker queues. Callables up to kInlineSize bytes
+// (a lambda capturing a few pointers, a shared_ptr or a std::packaged_task) are stored
+// inside the task, so wrapping and queueing them allocates nothing; larger ones, or ones
+// that may throw while being moved, are moved to the heap.
+class WorkerTask {
+public:
+    static constexpr size_t kInlineSize = 48;
+
+    WorkerTask() noexcept = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, WorkerTask>>>
+    WorkerTask(F&& callable) {
+        using Callable = std::decay_t<F>;
+        if constexpr (fitsInline<Callable>()) {
+            new (m_storage) Callable(std::forward<F>(callable));
+            m_ops = &InlineOps<Callable>::ops;
+        } else {
+            new (m_storage) Callable*(new Callable(std::forward<F>(callable)));
+            m_ops = &HeapOps<Callable>::ops;
+        }
+    }
+
+    WorkerTask(WorkerTask&& other) noexcept { takeFrom(other); }
+
+    WorkerTask& operator=(WorkerTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    WorkerTask(const WorkerTask&) = delete;
+    WorkerTask& operator=(const WorkerTask&) = delete;
+
+    ~WorkerTask() { reset(); }
+
+    void operator()() {
+        assert(m_ops && "invoking an empty WorkerTask");
+        m_ops->invoke(m_storage);
+    }
+    explicit operator bool() const { return m_ops != nullptr; }
+    // The callable lives in the task rather than on the heap
+    bool isInline() const { return m_ops != nullptr && m_ops->isInline; }
+
+    void reset() {
+        if (m_ops) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    template <typename Callable>
+    static constexpr bool fitsInline() {
+        return sizeof(Callable) <= kInlineSize && alignof(Callable) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<Callable>;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to) noexcept; // Leaves `from` destroyed
+        void (*destroy)(void* storage);
+        bool isInline;
+    };
+
+    template <typename Callable>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<Callable*>(storage))(); }
+        static void move(void* from, void* to) noexcept {
+            new (to) Callable(std::move(*static_cast<Callable*>(from)));
+            static_cast<Callable*>(from)->~Callable();
+        }
+        static void destroy(void* storage) { static_cast<Callable*>(storage)->~Callable(); }
+        static constexpr Ops ops{&invoke, &move, &destroy, true};
+    };
+
+    template <typename Callable>
+    struct HeapOps {
+        static Callable*& pointer(void* storage) { return *static_cast<Callable**>(storage); }
+        static void invoke(void* storage) { (*pointer(storage))(); }
+        static void move(void* from, void* to) noexcept { new (to) Callable*(pointer(from)); }
+        static void destroy(void* storage) { delete pointer(storage); }
+        static constexpr Ops ops{&invoke, &move, &destroy, false};
+    };
+
+    void takeFrom(WorkerTask& other) noexcept {
+        if (other.m_ops) {
+            other.m_ops->move(other.m_storage, m_storage);
+            m_ops = other.m_ops;
+            other.m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[kInlineSize];
+    const Ops* m_ops = nullptr;
+};
+
+// Queue of tasks that stops allocating once it has reached its working size
+using WorkerTaskRing = GrowableRing<WorkerTask>;
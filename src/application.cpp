@@ -31,6 +31,9 @@ Application::Application(const std::string& appName, LogWidget* logWidget)
 
     // Initialize HTTP client
     m_httpClient = std::make_unique<PlatformHttpClient>();
+    m_httpClient->setMainThreadDispatcher([this](std::function<void()> task) {
+        runOnMainThread(std::move(task));
+    });
 
     // State loading is handled externally after path is set
 
@@ -50,6 +53,8 @@ Application::Application(const std::string& appName, LogWidget* logWidget)
 Application::~Application()
 {
     LOG_INFO("Application destructor called.");
+    // Stop the HTTP engine while the main thread queue can still accept its final callbacks
+    m_httpClient.reset();
     // Save current page to state
     std::string pageStr;
     switch (m_currentPage) {
@@ -99,23 +104,22 @@ bool Application::initImGui()
     return true;
 }
 
+void Application::preconnect(const std::vector<std::string>& urls)
+{
+    if (m_httpClient && !urls.empty()) {
+        m_httpClient->preconnect(urls);
+    }
+}
+
 void Application::runOnMainThread(std::function<void()> task)
 {
-    std::unique_lock<std::mutex> lock(m_mainThreadMutex);
     m_mainThreadTasks.push(std::move(task));
 }
 
 void Application::processMainThreadTasks()
 {
     std::function<void()> task;
-    while (true) {
-        std::unique_lock<std::mutex> lock(m_mainThreadMutex);
-        if (m_mainThreadTasks.empty()) {
-            break;
-        }
-        task = m_mainThreadTasks.front();
-        m_mainThreadTasks.pop();
-        lock.unlock();
+    while (m_mainThreadTasks.tryPop(task)) {
         task();
     }
 }
@@ -223,6 +227,11 @@ void Application::renderFrame()
         HAlignment::CENTER,
         VAlignment::CENTER,
         [this]() {
+            // Nobody is left to see the answer once the user leaves the page
+            if (m_currentPage != Page::HttpGetDemo && m_httpGetCancel) {
+                m_httpGetCancel->cancel();
+                m_httpGetCancel.reset();
+            }
             // Render the current page
             switch (m_currentPage) {
                 case Page::Home:
@@ -289,22 +298,47 @@ void Application::renderHttpGetDemoPage()
     if (ImGui::Button("Send GET Request")) {
         Application* app = Application::getInstance();
         if (app) {
+            if (app->m_httpGetCancel) {
+                app->m_httpGetCancel->cancel();
+            }
+            auto token = std::make_shared<HttpCancelToken>();
+            app->m_httpGetCancel = token;
             app->m_statusBarMessage = "Status: Sending request...";
-            Worker::getInstance().postTask([app, url = std::string(urlBuffer)]() {
-                HttpResponse response = app->m_httpClient->get(url, {}, {});
-                app->runOnMainThread([app, response]() {
-                    if (response.status_code == 200) {
-                        app->m_httpGetResponse = response.text;
-                        app->m_statusBarMessage = "Status: Request successful!";
-                    } else {
-                        app->m_httpGetResponse = "Error: " + std::to_string(response.status_code) + " - " + response.text;
-                        app->m_statusBarMessage = "Status: Request failed with error " + std::to_string(response.status_code);
-                    }
-                });
+
+            HttpRequest request;
+            request.url = urlBuffer;
+            // Someone is waiting on this one: don't queue it behind background fetches
+            request.priority = HttpPriority::Interactive;
+            request.cancelToken = token;
+            // Runs on the HTTP I/O thread; the callback is dispatched to the main thread
+            app->m_httpClient->requestAsync(std::move(request), [app, token](HttpResult result) {
+                if (app->m_httpGetCancel != token) {
+                    return; // Superseded or cancelled
+                }
+                app->m_httpGetCancel.reset();
+                HttpResponse& response = result.response;
+                if (!result.ok()) {
+                    app->m_httpGetResponse = "Error: " + result.error;
+                    app->m_statusBarMessage = "Status: Request failed";
+                } else if (response.status_code == 200) {
+                    app->m_httpGetResponse = std::move(response.text);
+                    app->m_statusBarMessage = "Status: Request successful!";
+                } else {
+                    app->m_httpGetResponse = "Error: " + std::to_string(response.status_code) + " - " + response.text;
+                    app->m_statusBarMessage = "Status: Request failed with error " + std::to_string(response.status_code);
+                }
             });
         }
         LOG_INFO("Sending GET request to: %s", urlBuffer);
     }
+    if (m_httpGetCancel) {
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            m_httpGetCancel->cancel();
+            m_httpGetCancel.reset();
+            m_statusBarMessage = "Status: Request cancelled";
+        }
+    }
     ImGui::Text("Response:");
     ImGui::BeginChild("##http_response", ImVec2(0, 0), true);
     ImGui::TextWrapped("%s", m_httpGetResponse.c_str());
@@ -0,0 +1,423 @@
+#include "platform/http_async_engine.hpp"
+#include "platform/http_transfer.hpp"
+#include "platform/http_latency.hpp"
+#include "platform/logger.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <stdexcept>
+
+static const uint64_t kMinSamplesForHedging = 16;
+static const size_t kDefaultMaxActive = 16;
+
+HttpAsyncEngine::HttpAsyncEngine(HttpConnectionPool& pool, HttpLatencyTracker& latency)
+    : m_pool(pool)
+    , m_latency(latency)
+    , m_multi(curl_multi_init())
+    , m_rng(std::random_device()())
+    , m_cancellable(0)
+    , m_longLived(0)
+    , m_maxActive(kDefaultMaxActive)
+    , m_activeCount(0)
+    , m_queuedCount(0)
+    , m_retries(0)
+    , m_hedges(0)
+    , m_hedgeWins(0)
+    , m_running(true)
+{
+    if (!m_multi) {
+        throw std::runtime_error("Failed to initialize CURL multi handle");
+    }
+    m_ioThread = std::thread(&HttpAsyncEngine::threadLoop, this);
+}
+
+HttpAsyncEngine::~HttpAsyncEngine() {
+    {
+        // Under the lock submit() checks it with, so no job can be queued after the
+        // I/O thread's final failAll()
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    curl_multi_wakeup(m_multi);
+    if (m_ioThread.joinable()) {
+        m_ioThread.join();
+    }
+    curl_multi_cleanup(m_multi);
+}
+
+void HttpAsyncEngine::submit(HttpRequest request, Completion onComplete) {
+    std::unique_ptr<Job> job(new Job());
+    job->request = std::move(request);
+    job->onComplete = std::move(onComplete);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->policy = job->request.retryPolicy ? *job->request.retryPolicy : m_defaultPolicy;
+        if (m_running) {
+            m_pending.push_back(std::move(job));
+        }
+    }
+    if (job) {
+        // Engine is shutting down
+        job->onComplete(HttpResult{HttpResponse{}, "HTTP engine stopped"});
+        return;
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+std::future<HttpResponse> HttpAsyncEngine::submit(HttpRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+    submit(std::move(request), [promise](HttpResult result) {
+        if (result.ok()) {
+            promise->set_value(std::move(result.response));
+        } else {
+            promise->set_exception(std::make_exception_ptr(std::runtime_error(result.error)));
+        }
+    });
+    return future;
+}
+
+void HttpAsyncEngine::setDefaultPolicy(const HttpRetryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_defaultPolicy = policy;
+}
+
+HttpRetryPolicy HttpAsyncEngine::getDefaultPolicy() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_defaultPolicy;
+}
+
+void HttpAsyncEngine::threadLoop() {
+    while (m_running) {
+        startPending();
+        sweepCancelled();
+        runDueTimers();
+
+        int stillRunning = 0;
+        curl_multi_perform(m_multi, &stillRunning);
+
+        CURLMsg* msg = nullptr;
+        int msgsLeft = 0;
+        while ((msg = curl_multi_info_read(m_multi, &msgsLeft)) != nullptr) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL* handle = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            curl_multi_remove_handle(m_multi, handle);
+            onTransferDone(handle, code);
+        }
+        // Finished requests free slots for waiting ones
+        admitWaiting();
+
+        // Sleeps until socket activity, a curl timeout, the next retry/hedge timer or curl_multi_wakeup()
+        curl_multi_poll(m_multi, nullptr, 0, static_cast<int>(pollTimeoutMs()), nullptr);
+    }
+    failAll("HTTP engine stopped");
+}
+
+void HttpAsyncEngine::startPending() {
+    std::deque<std::unique_ptr<Job>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending.swap(m_pending);
+    }
+    for (auto& job : pending) {
+        m_waiting[static_cast<size_t>(job->request.priority)].push_back(std::move(job));
+    }
+    admitWaiting();
+}
+
+void HttpAsyncEngine::admitWaiting() {
+    const size_t maxActive = m_maxActive.load();
+    size_t queued = 0;
+    for (auto& queue : m_waiting) {
+        while (!queue.empty()) {
+            // Everything behind a blocked request has the same or a lower priority
+            const HttpRequest& next = queue.front()->request;
+            if (next.priority != HttpPriority::Interactive && !next.longLived
+                && m_jobs.size() - m_longLived >= maxActive) {
+                break;
+            }
+            std::unique_ptr<Job> job = std::move(queue.front());
+            queue.pop_front();
+            Job* raw = job.get();
+            raw->started = Clock::now();
+            raw->host = HttpConnectionPool::makeKey(raw->request.url);
+            // A reader body is consumed by the first attempt
+            raw->replayable = !raw->request.body.reader
+                && (raw->request.isIdempotent() || raw->policy.retryNonIdempotent);
+            m_longLived += raw->request.longLived ? 1 : 0;
+            m_jobs[raw] = std::move(job);
+            startAttempt(raw);
+        }
+        queued += queue.size();
+    }
+    m_queuedCount = queued;
+}
+
+void HttpAsyncEngine::sweepCancelled() {
+    size_t cancellable = 0;
+    for (auto& queue : m_waiting) {
+        for (auto it = queue.begin(); it != queue.end();) {
+            const std::shared_ptr<HttpCancelToken>& token = (*it)->request.cancelToken;
+            if (token && token->isCancelled()) {
+                notify(**it, HttpResult{HttpResponse{}, "Request cancelled"});
+                it = queue.erase(it);
+                continue;
+            }
+            cancellable += token ? 1 : 0;
+            ++it;
+        }
+    }
+
+    // Transfers notice the token themselves, but jobs waiting for a retry or hedge timer don't
+    std::vector<Job*> cancelled;
+    for (auto& entry : m_jobs) {
+        const std::shared_ptr<HttpCancelToken>& token = entry.first->request.cancelToken;
+        if (token && token->isCancelled()) {
+            cancelled.push_back(entry.first);
+        } else if (token) {
+            cancellable++;
+        }
+    }
+    for (Job* job : cancelled) {
+        finishJob(job, HttpResult{HttpResponse{}, "Request cancelled"});
+    }
+    m_cancellable = cancellable;
+    if (!cancelled.empty()) {
+        admitWaiting();
+    }
+}
+
+void HttpAsyncEngine::startAttempt(Job* job) {
+    job->attempts++;
+    if (!startTransfer(job, false)) {
+        return;
+    }
+    if (job->policy.hedge && job->replayable && !job->request.sink) {
+        std::chrono::milliseconds delay = hedgeDelay(*job);
+        if (delay.count() > 0) {
+            m_timers.emplace(Clock::now() + delay, Timer{job, TimerKind::Hedge});
+        }
+    }
+}
+
+bool HttpAsyncEngine::startTransfer(Job* job, bool hedge) {
+    const Clock::time_point now = Clock::now();
+    std::chrono::milliseconds timeout = job->policy.attemptTimeout;
+    if (job->policy.totalDeadline.count() > 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            job->started + job->policy.totalDeadline - now);
+        if (left.count() <= 0) {
+            if (job->inFlight.empty()) {
+                finishJob(job, HttpResult{HttpResponse{}, "HTTP request deadline exceeded"});
+                return false;
+            }
+            return true; // Too late for a hedge, but the current transfer may still answer
+        }
+        timeout = std::min(timeout, left);
+    }
+
+    std::unique_ptr<HttpTransfer> transfer;
+    try {
+        transfer.reset(new HttpTransfer(m_pool, job->request));
+    } catch (const std::exception& e) {
+        if (job->inFlight.empty()) {
+            finishJob(job, HttpResult{HttpResponse{}, e.what()});
+            return false;
+        }
+        return true;
+    }
+    transfer->setTimeout(timeout);
+
+    CURL* handle = transfer->handle();
+    curl_multi_add_handle(m_multi, handle);
+    m_active[handle] = job;
+    job->inFlight.push_back(InFlight{std::move(transfer), hedge});
+    m_activeCount = m_active.size();
+    return true;
+}
+
+void HttpAsyncEngine::onTransferDone(void* handle, int code) {
+    auto activeIt = m_active.find(handle);
+    if (activeIt == m_active.end()) {
+        return;
+    }
+    Job* job = activeIt->second;
+    m_active.erase(activeIt);
+    m_activeCount = m_active.size();
+
+    auto it = std::find_if(job->inFlight.begin(), job->inFlight.end(),
+                           [handle](const InFlight& f) { return f.transfer->handle() == handle; });
+    InFlight done = std::move(*it);
+    job->inFlight.erase(it);
+
+    const CURLcode result = static_cast<CURLcode>(code);
+    HttpTransfer& transfer = *done.transfer;
+    transfer.complete(result);
+    HttpResponse& response = transfer.response();
+    const Clock::time_point now = Clock::now();
+    if (result == CURLE_OK) {
+        m_latency.record(job->host, response.timing);
+    }
+
+    // A streamed body can't be taken back from the sink, so only retry before the first byte
+    const bool retryable = job->replayable
+        && !transfer.cancelledBySink()
+        && !transfer.cancelled()
+        && job->policy.isRetryable(result, response.status_code)
+        && !(job->request.sink && transfer.bodyBytes() > 0);
+
+    if (!retryable) {
+        if (done.hedge && result == CURLE_OK && response.status_code < 400) {
+            m_hedgeWins++;
+        }
+        HttpResult outcome{std::move(response), ""};
+        if (result != CURLE_OK && !transfer.cancelledBySink()) {
+            outcome.error = transfer.describeFailure(result);
+        }
+        finishJob(job, std::move(outcome));
+        return;
+    }
+
+    if (!job->inFlight.empty()) {
+        // The other leg of a hedged attempt may still succeed
+        return;
+    }
+
+    if (job->attempts < job->policy.maxAttempts) {
+        std::chrono::milliseconds delay = job->policy.backoff(job->attempts, m_rng);
+        bool serverAllowsRetry = true;
+        if (auto retryAfter = response.headers.find("retry-after")) {
+            if (std::optional<std::chrono::seconds> wait = parseRetryAfter(*retryAfter)) {
+                // A server asking for more than maxBackoff gets its answer passed on instead of
+                // parking the request that long
+                if (*wait > job->policy.maxBackoff) {
+                    serverAllowsRetry = false;
+                } else {
+                    delay = std::max(delay, std::chrono::milliseconds(*wait));
+                }
+            }
+        }
+        const bool withinDeadline = job->policy.totalDeadline.count() == 0
+            || now + delay < job->started + job->policy.totalDeadline;
+        if (serverAllowsRetry && withinDeadline) {
+            cancelTimers(job);
+            m_timers.emplace(now + delay, Timer{job, TimerKind::Retry});
+            return;
+        }
+    }
+
+    // Out of attempts: report the last outcome as is
+    HttpResult outcome{std::move(response), ""};
+    if (result != CURLE_OK) {
+        outcome.error = transfer.describeFailure(result);
+    }
+    finishJob(job, std::move(outcome));
+}
+
+void HttpAsyncEngine::runDueTimers() {
+    const Clock::time_point now = Clock::now();
+    while (!m_timers.empty() && m_timers.begin()->first <= now) {
+        Timer timer = m_timers.begin()->second;
+        m_timers.erase(m_timers.begin());
+        if (m_jobs.find(timer.job) == m_jobs.end()) {
+            continue;
+        }
+        if (timer.kind == TimerKind::Retry) {
+            m_retries++;
+            startAttempt(timer.job);
+        } else if (timer.job->inFlight.size() == 1 && !timer.job->inFlight.front().hedge) {
+            m_hedges++;
+            startTransfer(timer.job, true);
+        }
+    }
+}
+
+long HttpAsyncEngine::pollTimeoutMs() const {
+    // Cancel tokens have no way to wake the loop, so check them more often while any exist
+    const long maxWait = m_cancellable > 0 ? 100 : 1000;
+    if (m_timers.empty()) {
+        return maxWait;
+    }
+    auto untilNext = std::chrono::duration_cast<std::chrono::milliseconds>(
+        m_timers.begin()->first - Clock::now()).count();
+    return std::max(0L, std::min(maxWait, static_cast<long>(untilNext)));
+}
+
+void HttpAsyncEngine::finishJob(Job* job, HttpResult result) {
+    removeTransfers(job);
+    cancelTimers(job);
+    auto it = m_jobs.find(job);
+    if (it == m_jobs.end()) {
+        return;
+    }
+    std::unique_ptr<Job> owned = std::move(it->second);
+    m_jobs.erase(it);
+    m_longLived -= owned->request.longLived ? 1 : 0;
+    notify(*owned, std::move(result));
+}
+
+void HttpAsyncEngine::notify(Job& job, HttpResult result) {
+    try {
+        job.onComplete(std::move(result));
+    } catch (const std::exception& e) {
+        LOG_ERROR("HTTP completion handler for %s threw: %s", job.request.url.c_str(), e.what());
+    }
+}
+
+void HttpAsyncEngine::removeTransfers(Job* job) {
+    for (InFlight& flight : job->inFlight) {
+        CURL* handle = flight.transfer->handle();
+        curl_multi_remove_handle(m_multi, handle);
+        m_active.erase(handle);
+    }
+    // Destroying an unfinished transfer closes its handle instead of pooling it
+    job->inFlight.clear();
+    m_activeCount = m_active.size();
+}
+
+void HttpAsyncEngine::cancelTimers(Job* job) {
+    for (auto it = m_timers.begin(); it != m_timers.end();) {
+        if (it->second.job == job) {
+            it = m_timers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void HttpAsyncEngine::failAll(const std::string& error) {
+    std::vector<Job*> jobs;
+    for (auto& entry : m_jobs) {
+        jobs.push_back(entry.first);
+    }
+    for (Job* job : jobs) {
+        finishJob(job, HttpResult{HttpResponse{}, error});
+    }
+
+    std::deque<std::unique_ptr<Job>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending.swap(m_pending);
+    }
+    for (auto& queue : m_waiting) {
+        for (auto& job : queue) {
+            pending.push_back(std::move(job));
+        }
+        queue.clear();
+    }
+    m_queuedCount = 0;
+    for (auto& job : pending) {
+        notify(*job, HttpResult{HttpResponse{}, error});
+    }
+}
+
+std::chrono::milliseconds HttpAsyncEngine::hedgeDelay(const Job& job) const {
+    HttpLatencyHistogram histogram = m_latency.getTotal(job.host);
+    if (histogram.getCount() < kMinSamplesForHedging) {
+        return std::chrono::milliseconds(0);
+    }
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(histogram.percentile(job.policy.hedgePercentile));
+    return std::max(delay, job.policy.minHedgeDelay);
+}
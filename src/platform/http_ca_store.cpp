@@ -0,0 +1,81 @@
+#include "platform/http_ca_store.hpp"
+#include "platform/cacert_pem_data.hpp"
+#include "platform/logger.h"
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+HttpCaStore& HttpCaStore::getInstance() {
+    static HttpCaStore instance;
+    return instance;
+}
+
+HttpCaStore::HttpCaStore()
+    : m_store(X509_STORE_new())
+    , m_certificateCount(0)
+{
+    if (!m_store) {
+        LOG_ERROR("Failed to allocate the CA store");
+        return;
+    }
+    addCertificates(std::string_view(reinterpret_cast<const char*>(cacert_pem), cacert_pem_len));
+    if (m_certificateCount == 0) {
+        LOG_ERROR("No CA certificates could be loaded from the embedded bundle");
+        X509_STORE_free(m_store);
+        m_store = nullptr;
+        return;
+    }
+    // Same as curl's default for its own stores: trust anchors may be intermediates
+    X509_STORE_set_flags(m_store, X509_V_FLAG_PARTIAL_CHAIN);
+}
+
+size_t HttpCaStore::addCertificates(std::string_view pem) {
+    if (!m_store) {
+        return 0;
+    }
+    size_t added = 0;
+    BIO* bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+    STACK_OF(X509_INFO)* infos = bio ? PEM_X509_INFO_read_bio(bio, nullptr, nullptr, nullptr) : nullptr;
+    if (infos) {
+        for (int i = 0; i < sk_X509_INFO_num(infos); ++i) {
+            X509_INFO* info = sk_X509_INFO_value(infos, i);
+            if (info->x509 && X509_STORE_add_cert(m_store, info->x509) == 1) {
+                added++;
+            }
+        }
+        sk_X509_INFO_pop_free(infos, X509_INFO_free);
+    }
+    BIO_free(bio);
+    m_certificateCount += added;
+    return added;
+}
+
+HttpCaStore::~HttpCaStore() {
+    if (m_store) {
+        X509_STORE_free(m_store);
+    }
+}
+
+void HttpCaStore::apply(CURL* handle) {
+    // Keep curl from loading a CA file or directory of its own
+    curl_easy_setopt(handle, CURLOPT_CAINFO, nullptr);
+    curl_easy_setopt(handle, CURLOPT_CAPATH, nullptr);
+
+    if (m_store && curl_easy_setopt(handle, CURLOPT_SSL_CTX_FUNCTION, sslContextCallback) == CURLE_OK) {
+        curl_easy_setopt(handle, CURLOPT_SSL_CTX_DATA, this);
+        return;
+    }
+    // Not an OpenSSL build of curl: let it parse the bundle from memory instead
+    curl_blob blob;
+    blob.data = cacert_pem;
+    blob.len = cacert_pem_len;
+    blob.flags = CURL_BLOB_NOCOPY;
+    curl_easy_setopt(handle, CURLOPT_CAINFO_BLOB, &blob);
+}
+
+CURLcode HttpCaStore::sslContextCallback(CURL*, void* sslContext, void* userptr) {
+    HttpCaStore* self = static_cast<HttpCaStore*>(userptr);
+    // Takes a reference: the store is shared, not copied, by every SSL_CTX
+    SSL_CTX_set1_cert_store(static_cast<SSL_CTX*>(sslContext), self->m_store);
+    return CURLE_OK;
+}
@@ -0,0 +1,382 @@
+#include "platform/http_cache.hpp"
+#include "platform/http_digest.hpp"
+#include "platform/http_request_key.hpp"
+#include "platform/state_manager.h"
+#include "platform/logger.h"
+#include "nlohmann/json.hpp"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+static size_t entrySize(const std::string& key, const HttpResponse& response) {
+    return key.size() + response.text.size() + response.headers.byteSize();
+}
+
+CachingHttpClient::CachingHttpClient(IHttpClient& inner, const std::string& cacheDir,
+                                     size_t maxMemoryBytes, size_t maxDiskBytes)
+    : m_inner(inner)
+    , m_cacheDir(cacheDir)
+    , m_maxMemoryBytes(maxMemoryBytes)
+    , m_maxDiskBytes(maxDiskBytes)
+    , m_diskBytes(0)
+    , m_memoryBytes(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_revalidations(0)
+    , m_notModified(0)
+    , m_bytesSaved(0)
+{
+    if (m_cacheDir.empty()) {
+        m_cacheDir = StateManager::getInstance().getInternalDataPath() + "/http_cache";
+    }
+    std::error_code ec;
+    fs::create_directories(m_cacheDir, ec);
+    if (ec) {
+        LOG_WARN("HTTP cache directory %s unavailable (%s), caching in memory only",
+                 m_cacheDir.c_str(), ec.message().c_str());
+        m_cacheDir.clear();
+        return;
+    }
+    pruneDisk();
+}
+
+HttpResponse CachingHttpClient::get(const std::string& url,
+                                    const std::map<std::string, std::string>& params,
+                                    const std::map<std::string, std::string>& headers) {
+    const std::string key = makeRequestKey(url, params, headers);
+    const std::time_t now = std::time(nullptr);
+
+    Entry cached;
+    bool haveCached = lookup(key, cached);
+    if (haveCached && !cached.mustRevalidate && now < cached.expiresAt) {
+        m_hits++;
+        m_bytesSaved += cached.response.wire_bytes;
+        return cached.response;
+    }
+
+    std::map<std::string, std::string> requestHeaders = headers;
+    if (haveCached) {
+        if (!cached.etag.empty()) {
+            requestHeaders["If-None-Match"] = cached.etag;
+        }
+        if (!cached.lastModified.empty()) {
+            requestHeaders["If-Modified-Since"] = cached.lastModified;
+        }
+        m_revalidations++;
+    }
+
+    HttpResponse response = m_inner.get(url, params, requestHeaders);
+
+    if (haveCached && response.status_code == 304) {
+        m_notModified++;
+        m_bytesSaved += cached.response.wire_bytes;
+        // A 304 may carry refreshed freshness information and validators
+        cached.response.headers.merge(response.headers);
+        if (applyCachePolicy(cached, now)) {
+            store(cached);
+        } else {
+            remove(key);
+        }
+        return cached.response;
+    }
+
+    m_misses++;
+    Entry fresh;
+    fresh.key = key;
+    fresh.response = std::move(response);
+    if (applyCachePolicy(fresh, now)) {
+        store(fresh);
+    } else if (haveCached) {
+        remove(key);
+    }
+    return std::move(fresh.response);
+}
+
+HttpResponse CachingHttpClient::request(const HttpRequest& request) {
+    if (request.isPlainGet()) {
+        return get(request.url, request.params, request.headers);
+    }
+    return m_inner.request(request);
+}
+
+HttpCacheStats CachingHttpClient::getStats() const {
+    return HttpCacheStats{m_hits.load(), m_misses.load(), m_revalidations.load(),
+                          m_notModified.load(), m_bytesSaved.load()};
+}
+
+void CachingHttpClient::clear() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lru.clear();
+        m_index.clear();
+        m_memoryBytes = 0;
+    }
+    if (m_cacheDir.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_diskMutex);
+    std::error_code ec;
+    for (const auto& file : fs::directory_iterator(m_cacheDir, ec)) {
+        fs::remove(file.path(), ec);
+    }
+    m_diskBytes = 0;
+}
+
+bool CachingHttpClient::applyCachePolicy(Entry& entry, std::time_t now) {
+    if (entry.response.status_code != 200) {
+        return false;
+    }
+    const HttpHeaders& headers = entry.response.headers;
+    auto header = [&headers](const char* name) {
+        return std::string(headers.get(name));
+    };
+
+    // Directives may be spread over several Cache-Control fields
+    std::string cacheControl;
+    for (HttpHeaders::Field field : headers) {
+        if (toLower(std::string(field.name)) == "cache-control") {
+            cacheControl.append(toLower(std::string(field.value))).append(",");
+        }
+    }
+    if (cacheControl.find("no-store") != std::string::npos) {
+        return false;
+    }
+    entry.etag = header("etag");
+    entry.lastModified = header("last-modified");
+    entry.mustRevalidate = cacheControl.find("no-cache") != std::string::npos;
+    entry.expiresAt = now;
+
+    size_t maxAgePos = cacheControl.find("max-age=");
+    if (maxAgePos != std::string::npos) {
+        long maxAge = std::strtol(cacheControl.c_str() + maxAgePos + 8, nullptr, 10);
+        entry.expiresAt = now + std::max(0L, maxAge);
+    } else {
+        std::string expires = header("expires");
+        if (!expires.empty()) {
+            time_t parsed = curl_getdate(expires.c_str(), nullptr);
+            if (parsed > 0) {
+                entry.expiresAt = parsed;
+            }
+        }
+    }
+
+    // Worth keeping only if it can be served fresh or revalidated later
+    bool fresh = !entry.mustRevalidate && entry.expiresAt > now;
+    return fresh || !entry.etag.empty() || !entry.lastModified.empty();
+}
+
+bool CachingHttpClient::lookup(const std::string& key, Entry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            entry = *it->second;
+            return true;
+        }
+    }
+    if (loadFromDisk(key, entry)) {
+        storeInMemory(entry);
+        return true;
+    }
+    return false;
+}
+
+void CachingHttpClient::store(const Entry& entry) {
+    storeInMemory(entry);
+    saveToDisk(entry);
+}
+
+void CachingHttpClient::storeInMemory(const Entry& entry) {
+    const size_t size = entrySize(entry.key, entry.response);
+    if (size > m_maxMemoryBytes) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(entry.key);
+    if (it != m_index.end()) {
+        m_memoryBytes -= entrySize(it->second->key, it->second->response);
+        m_lru.erase(it->second);
+    }
+    m_lru.push_front(entry);
+    m_index[entry.key] = m_lru.begin();
+    m_memoryBytes += size;
+
+    while (m_memoryBytes > m_maxMemoryBytes && !m_lru.empty()) {
+        const Entry& oldest = m_lru.back();
+        m_memoryBytes -= entrySize(oldest.key, oldest.response);
+        m_index.erase(oldest.key);
+        m_lru.pop_back();
+    }
+}
+
+void CachingHttpClient::remove(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_memoryBytes -= entrySize(it->second->key, it->second->response);
+            m_lru.erase(it->second);
+            m_index.erase(it);
+        }
+    }
+    if (m_cacheDir.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_diskMutex);
+    const std::string path = entryPath(key);
+    std::error_code ec;
+    for (const std::string& file : {path + ".meta", path + ".body"}) {
+        uintmax_t size = fs::file_size(file, ec);
+        if (!ec && fs::remove(file, ec)) {
+            m_diskBytes -= std::min<size_t>(m_diskBytes, static_cast<size_t>(size));
+        }
+    }
+}
+
+bool CachingHttpClient::loadFromDisk(const std::string& key, Entry& entry) {
+    if (m_cacheDir.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_diskMutex);
+    const std::string path = entryPath(key);
+    std::ifstream metaFile(path + ".meta");
+    if (!metaFile.is_open()) {
+        return false;
+    }
+    try {
+        nlohmann::json meta;
+        metaFile >> meta;
+        if (meta.at("key").get<std::string>() != key) {
+            return false; // Hash collision with another request
+        }
+        entry.key = key;
+        entry.response.status_code = meta.at("status").get<int>();
+        entry.response.headers = HttpHeaders::parse(meta.at("headers").get<std::string>());
+        entry.etag = meta.at("etag").get<std::string>();
+        entry.lastModified = meta.at("last_modified").get<std::string>();
+        entry.expiresAt = static_cast<std::time_t>(meta.at("expires_at").get<int64_t>());
+        entry.mustRevalidate = meta.at("must_revalidate").get<bool>();
+        entry.response.wire_bytes = meta.at("wire_bytes").get<size_t>();
+    } catch (const nlohmann::json::exception& e) {
+        LOG_ERROR("Error parsing HTTP cache entry %s: %s", path.c_str(), e.what());
+        return false;
+    }
+
+    std::ifstream bodyFile(path + ".body", std::ios::binary);
+    if (!bodyFile.is_open()) {
+        return false;
+    }
+    std::ostringstream body;
+    body << bodyFile.rdbuf();
+    entry.response.text = body.str();
+    entry.response.decoded_bytes = entry.response.text.size();
+    return true;
+}
+
+void CachingHttpClient::saveToDisk(const Entry& entry) {
+    if (m_cacheDir.empty() || entry.response.text.size() > m_maxDiskBytes) {
+        return;
+    }
+    nlohmann::json meta;
+    meta["key"] = entry.key;
+    meta["status"] = entry.response.status_code;
+    meta["headers"] = entry.response.headers.serialize();
+    meta["etag"] = entry.etag;
+    meta["last_modified"] = entry.lastModified;
+    meta["expires_at"] = static_cast<int64_t>(entry.expiresAt);
+    meta["must_revalidate"] = entry.mustRevalidate;
+    meta["wire_bytes"] = entry.response.wire_bytes;
+    std::string metaText;
+    try {
+        metaText = meta.dump();
+    } catch (const nlohmann::json::exception& e) {
+        // Header values that are not valid UTF-8
+        LOG_WARN("Not persisting HTTP cache entry for %s: %s", entry.key.c_str(), e.what());
+        return;
+    }
+
+    bool overBudget = false;
+    {
+        std::lock_guard<std::mutex> lock(m_diskMutex);
+        const std::string path = entryPath(entry.key);
+        // Overwriting an entry replaces its files, so their old size no longer counts
+        std::error_code ec;
+        for (const std::string& file : {path + ".meta", path + ".body"}) {
+            uintmax_t size = fs::file_size(file, ec);
+            if (!ec) {
+                m_diskBytes -= std::min<size_t>(m_diskBytes, static_cast<size_t>(size));
+            }
+        }
+        // Body first: a meta file without its body is treated as a miss, never the reverse
+        std::ofstream bodyFile(path + ".body", std::ios::binary | std::ios::trunc);
+        bodyFile.write(entry.response.text.data(), entry.response.text.size());
+        bodyFile.close();
+        std::ofstream metaFile(path + ".meta", std::ios::trunc);
+        metaFile << metaText;
+        metaFile.close();
+        if (!bodyFile || !metaFile) {
+            LOG_ERROR("Failed to write HTTP cache entry %s", path.c_str());
+            return;
+        }
+        m_diskBytes += entry.response.text.size() + metaText.size();
+        overBudget = m_diskBytes > m_maxDiskBytes;
+    }
+    if (overBudget) {
+        pruneDisk();
+    }
+}
+
+void CachingHttpClient::pruneDisk() {
+    std::lock_guard<std::mutex> lock(m_diskMutex);
+    struct CachedFile {
+        fs::path path;
+        fs::file_time_type lastWrite;
+        uintmax_t size;
+    };
+    std::vector<CachedFile> files;
+    size_t total = 0;
+    std::error_code ec;
+    for (const auto& file : fs::directory_iterator(m_cacheDir, ec)) {
+        if (!file.is_regular_file(ec)) {
+            continue;
+        }
+        CachedFile cached{file.path(), file.last_write_time(ec), file.file_size(ec)};
+        total += static_cast<size_t>(cached.size);
+        files.push_back(std::move(cached));
+    }
+
+    // Leave some headroom so the next stores don't trigger another scan right away
+    const size_t target = m_maxDiskBytes - m_maxDiskBytes / 4;
+    if (total > m_maxDiskBytes) {
+        std::sort(files.begin(), files.end(),
+                  [](const CachedFile& a, const CachedFile& b) { return a.lastWrite < b.lastWrite; });
+        for (const CachedFile& file : files) {
+            if (total <= target) {
+                break;
+            }
+            if (fs::remove(file.path, ec)) {
+                total -= std::min<size_t>(total, static_cast<size_t>(file.size));
+            }
+        }
+    }
+    m_diskBytes = total;
+}
+
+std::string CachingHttpClient::entryPath(const std::string& key) const {
+    // std::hash may differ between builds, which would orphan every entry on disk
+    return m_cacheDir + '/' + sha256Hex(key);
+}
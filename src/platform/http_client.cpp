@@ -1,91 +1,283 @@
 #include "platform/http_client.hpp"
-#include "platform/write_cacert.hpp"
+#include "platform/http_async_engine.hpp"
+#include "platform/http_latency.hpp"
+#include "platform/http_transfer.hpp"
+#include "platform/state_manager.h"
 #include "platform/logger.h" // Include logger.h
 #include <curl/curl.h>
-#include <sstream>
 #include <stdexcept>
-#include <cstdio> // for std::remove
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    std::string* str = static_cast<std::string*>(userp);
-    size_t total_size = size * nmemb;
-    str->append(static_cast<char*>(contents), total_size);
-    return total_size;
+static HttpRequest makeGetRequest(const std::string& url,
+                                  const std::map<std::string, std::string>& params,
+                                  const std::map<std::string, std::string>& headers) {
+    HttpRequest request;
+    request.url = url;
+    request.params = params;
+    request.headers = headers;
+    return request;
 }
 
-HttpClient::HttpClient() {
-    write_cacert_pem_if_not_exists();
-    m_caBundlePath = get_cacert_path();
+bool HttpRequest::isIdempotent() const {
+    return method != "POST" && method != "PATCH";
 }
 
-HttpClient::~HttpClient() {
-    // The cacert.pem file is no longer a temporary file, so we don't remove it here.
+bool HttpRequest::isPlainGet() const {
+    return method == "GET" && body.empty() && form.empty() && !sink && !checkResponse && !retryPolicy && acceptCompressed
+        && priority == HttpPriority::Normal && !cancelToken && !longLived;
 }
 
+HttpClient::HttpClient()
+    : m_share(StateManager::getInstance().getInternalDataPath() + "/tls_sessions.json")
+    , m_latency(new HttpLatencyTracker())
+{
+    m_pool.setShare(m_share.handle());
+    m_engine.reset(new HttpAsyncEngine(m_pool, *m_latency));
+}
+
+HttpClient::~HttpClient() = default;
+
 HttpResponse HttpClient::get(const std::string& url,
                                     const std::map<std::string, std::string>& params,
                                     const std::map<std::string, std::string>& headers) {
-    CURL* curl = curl_easy_init();
-    std::string response_data;
-    HttpResponse resp{0, ""};
+    return getAsync(url, params, headers).get();
+}
+
+HttpResponse HttpClient::request(const HttpRequest& request) {
+    return requestAsync(request).get();
+}
 
-    if (!curl) {
-        throw std::runtime_error("Failed to initialize CURL");
+std::future<HttpResponse> HttpClient::getAsync(const std::string& url,
+                                               const std::map<std::string, std::string>& params,
+                                               const std::map<std::string, std::string>& headers,
+                                               std::shared_ptr<HttpCancelToken> cancelToken) {
+    HttpRequest request = makeGetRequest(url, params, headers);
+    request.cancelToken = std::move(cancelToken);
+    return m_engine->submit(std::move(request));
+}
+
+std::future<HttpResponse> HttpClient::requestAsync(HttpRequest request) {
+    return m_engine->submit(std::move(request));
+}
+
+void HttpClient::requestAsync(HttpRequest request, std::function<void(HttpResult)> onComplete) {
+    m_engine->submit(std::move(request), [this, onComplete](HttpResult result) {
+        auto shared = std::make_shared<HttpResult>(std::move(result));
+        dispatchToMainThread([onComplete, shared]() { onComplete(std::move(*shared)); });
+    });
+}
+
+void HttpClient::getAsync(const std::string& url,
+                          const std::map<std::string, std::string>& params,
+                          const std::map<std::string, std::string>& headers,
+                          std::function<void(HttpResult)> onComplete,
+                          std::shared_ptr<HttpCancelToken> cancelToken) {
+    HttpRequest request = makeGetRequest(url, params, headers);
+    request.cancelToken = std::move(cancelToken);
+    requestAsync(std::move(request), std::move(onComplete));
+}
+
+HttpResponse HttpClient::getStream(const std::string& url,
+                                   const std::map<std::string, std::string>& params,
+                                   const std::map<std::string, std::string>& headers,
+                                   HttpChunkSink sink,
+                                   std::shared_ptr<HttpCancelToken> cancelToken) {
+    HttpRequest request = makeGetRequest(url, params, headers);
+    request.sink = std::move(sink);
+    request.cancelToken = std::move(cancelToken);
+    HttpTransfer transfer(m_pool, request);
+    // Streamed bodies can't be replayed, so only the timeout of the retry policy applies here
+    transfer.setTimeout(m_engine->getDefaultPolicy().attemptTimeout);
+    CURLcode res = transfer.perform();
+    transfer.complete(res);
+    if (res == CURLE_OK) {
+        m_latency->record(HttpConnectionPool::makeKey(url), transfer.response().timing);
     }
+    if (res != CURLE_OK && !transfer.cancelledBySink()) {
+        throw std::runtime_error(transfer.describeFailure(res));
+    }
+    return std::move(transfer.response());
+}
 
-    // Compose URL with query parameters
-    std::ostringstream oss;
-    oss << url;
-    if (!params.empty()) {
-        oss << "?";
-        bool first = true;
-        for (const auto& kv : params) {
-            if (!first) oss << "&";
-            first = false;
-            char* key_escaped = curl_easy_escape(curl, kv.first.c_str(), 0);
-            char* val_escaped = curl_easy_escape(curl, kv.second.c_str(), 0);
-            oss << key_escaped << "=" << val_escaped;
-            curl_free(key_escaped);
-            curl_free(val_escaped);
+std::future<std::vector<HttpPreconnectResult>> HttpClient::preconnect(const std::vector<std::string>& urls) {
+    struct PreconnectState {
+        std::mutex mutex;
+        std::vector<HttpPreconnectResult> results;
+        size_t remaining = 0;
+        std::promise<std::vector<HttpPreconnectResult>> promise;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+    auto state = std::make_shared<PreconnectState>();
+    std::future<std::vector<HttpPreconnectResult>> future = state->promise.get_future();
+
+    for (const std::string& url : urls) {
+        const std::string origin = HttpConnectionPool::makeKey(url);
+        bool seen = std::any_of(state->results.begin(), state->results.end(),
+                                [&](const HttpPreconnectResult& result) { return result.origin == origin; });
+        if (!seen) {
+            state->results.push_back({origin, "", HttpTiming()});
         }
     }
-    std::string full_url = oss.str();
-    
-
-    curl_easy_setopt(curl, CURLOPT_URL, full_url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_data);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-    // Set headers
-    struct curl_slist* chunk = nullptr;
-    for (const auto& kv : headers) {
-        std::string header_line = kv.first + ": " + kv.second;
-        chunk = curl_slist_append(chunk, header_line.c_str());
+    state->remaining = state->results.size();
+    if (state->remaining == 0) {
+        state->promise.set_value({});
+        return future;
     }
-    if (chunk) {
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+
+    HttpRetryPolicy once;
+    once.maxAttempts = 1;
+    for (size_t i = 0; i < state->results.size(); ++i) {
+        HttpRequest request;
+        request.method = "HEAD";
+        request.url = state->results[i].origin + "/";
+        request.acceptCompressed = false;
+        request.priority = HttpPriority::Prefetch;
+        request.retryPolicy = once;
+        m_engine->submit(std::move(request), [state, i](HttpResult result) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            HttpPreconnectResult& preconnect = state->results[i];
+            preconnect.error = result.error;
+            preconnect.timing = result.response.timing;
+            if (preconnect.ok()) {
+                LOG_INFO("Preconnected %s: DNS %lld us, TCP %lld us, TLS %lld us", preconnect.origin.c_str(),
+                         static_cast<long long>(preconnect.timing.name_lookup.count()),
+                         static_cast<long long>((preconnect.timing.connect - preconnect.timing.name_lookup).count()),
+                         static_cast<long long>(preconnect.timing.app_connect.count() > 0
+                             ? (preconnect.timing.app_connect - preconnect.timing.connect).count() : 0));
+            } else {
+                LOG_WARN("Preconnect to %s failed: %s", preconnect.origin.c_str(), preconnect.error.c_str());
+            }
+            if (--state->remaining == 0) {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - state->start);
+                const size_t warmed = std::count_if(state->results.begin(), state->results.end(),
+                                                    [](const HttpPreconnectResult& r) { return r.ok(); });
+                LOG_INFO("Prewarmed %zu of %zu hosts in %lld ms", warmed, state->results.size(),
+                         static_cast<long long>(elapsed.count()));
+                state->promise.set_value(state->results);
+            }
+        });
     }
+    return future;
+}
 
-    // Set CAINFO from the path stored in the constructor
-    curl_easy_setopt(curl, CURLOPT_CAINFO, m_caBundlePath.c_str());
+std::vector<HttpResult> HttpClient::getBatch(std::vector<HttpRequest> requests,
+                                             const HttpBatchOptions& options) {
+    struct BatchState {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<HttpResult> results;
+        std::vector<size_t> finished; // Completed since the last report, in completion order
+        std::map<std::string, size_t> activePerHost;
+        size_t active = 0;
+        size_t completed = 0;
+    };
+    auto state = std::make_shared<BatchState>();
+    const size_t total = requests.size();
+    state->results.resize(total);
 
-    CURLcode res = curl_easy_perform(curl);
+    std::vector<std::string> hosts(total);
+    std::deque<size_t> waiting;
+    for (size_t i = 0; i < total; ++i) {
+        hosts[i] = HttpConnectionPool::makeKey(requests[i].url);
+        waiting.push_back(i);
+    }
+    const size_t maxParallel = std::max<size_t>(options.maxParallel, 1);
+    const size_t maxPerHost = std::max<size_t>(options.maxPerHost, 1);
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    resp.status_code = static_cast<int>(http_code);
-    resp.text = response_data;
+    size_t reported = 0;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (reported < total) {
+        // Start the earliest waiting requests whose host still has a free slot
+        for (auto it = waiting.begin(); it != waiting.end() && state->active < maxParallel;) {
+            const size_t index = *it;
+            if (state->activePerHost[hosts[index]] >= maxPerHost) {
+                ++it;
+                continue;
+            }
+            state->active++;
+            state->activePerHost[hosts[index]]++;
+            it = waiting.erase(it);
 
-    if (chunk) {
-        curl_slist_free_all(chunk);
-    }
-    curl_easy_cleanup(curl);
+            lock.unlock();
+            m_engine->submit(std::move(requests[index]), [state, index, host = hosts[index]](HttpResult result) {
+                std::lock_guard<std::mutex> guard(state->mutex);
+                state->results[index] = std::move(result);
+                state->finished.push_back(index);
+                state->active--;
+                state->activePerHost[host]--;
+                state->completed++;
+                state->done.notify_one();
+            });
+            lock.lock();
+        }
 
-    if (res != CURLE_OK) {
-        throw std::runtime_error(std::string("curl_easy_perform() failed: ") + curl_easy_strerror(res));
+        state->done.wait(lock, [&] { return state->completed > reported; });
+        const size_t completed = state->completed;
+        std::vector<size_t> finished;
+        finished.swap(state->finished);
+        if (options.onProgress || options.onResult) {
+            // Finished results are no longer written by the engine, so they can be read unlocked
+            lock.unlock();
+            for (size_t i = 0; i < finished.size(); ++i) {
+                if (options.onResult) {
+                    options.onResult(finished[i], state->results[finished[i]]);
+                }
+                if (options.onProgress) {
+                    options.onProgress(reported + i + 1, total);
+                }
+            }
+            lock.lock();
+        }
+        reported = completed;
     }
+    return std::move(state->results);
+}
+
+void HttpClient::setRetryPolicy(const HttpRetryPolicy& policy) {
+    m_engine->setDefaultPolicy(policy);
+}
+
+HttpRetryPolicy HttpClient::getRetryPolicy() const {
+    return m_engine->getDefaultPolicy();
+}
+
+uint64_t HttpClient::getRetryCount() const {
+    return m_engine->getRetryCount();
+}
+
+uint64_t HttpClient::getHedgeCount() const {
+    return m_engine->getHedgeCount();
+}
 
-    return resp;
+uint64_t HttpClient::getHedgeWinCount() const {
+    return m_engine->getHedgeWinCount();
+}
+
+void HttpClient::setMaxActiveRequests(size_t maxActive) {
+    m_engine->setMaxActive(maxActive);
+}
+
+size_t HttpClient::getQueuedRequestCount() const {
+    return m_engine->getQueuedCount();
+}
+
+void HttpClient::setMainThreadDispatcher(std::function<void(std::function<void()>)> dispatcher) {
+    std::lock_guard<std::mutex> lock(m_dispatcherMutex);
+    m_dispatcher = std::move(dispatcher);
+}
+
+void HttpClient::dispatchToMainThread(std::function<void()> task) {
+    std::function<void(std::function<void()>)> dispatcher;
+    {
+        std::lock_guard<std::mutex> lock(m_dispatcherMutex);
+        dispatcher = m_dispatcher;
+    }
+    if (dispatcher) {
+        dispatcher(std::move(task));
+    } else {
+        task();
+    }
 }
@@ -0,0 +1,89 @@
+#include "platform/http_coalescing.hpp"
+#include "platform/http_request_key.hpp"
+#include <algorithm>
+
+CoalescingHttpClient::CoalescingHttpClient(IHttpClient& inner)
+    : m_inner(inner)
+    , m_transfers(0)
+    , m_coalesced(0)
+    , m_maxWaiters(0)
+{
+}
+
+HttpResponse CoalescingHttpClient::get(const std::string& url,
+                                       const std::map<std::string, std::string>& params,
+                                       const std::map<std::string, std::string>& headers) {
+    const std::string key = makeKey(url, params, headers);
+
+    std::promise<HttpResponse> promise;
+    std::shared_ptr<Flight> flight;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = m_inFlight.find(key);
+        if (it != m_inFlight.end()) {
+            flight = it->second;
+            flight->waiters++;
+            m_maxWaiters = std::max(m_maxWaiters, flight->waiters);
+            m_coalesced++;
+            lock.unlock();
+            HttpResponse response;
+            try {
+                response = flight->result.get();
+            } catch (...) {
+                std::lock_guard<std::mutex> relock(m_mutex);
+                flight->waiters--;
+                throw;
+            }
+            std::lock_guard<std::mutex> relock(m_mutex);
+            flight->waiters--;
+            return response;
+        }
+        flight = std::make_shared<Flight>(Flight{promise.get_future().share(), 0});
+        m_inFlight[key] = flight;
+    }
+
+    m_transfers++;
+    HttpResponse response;
+    try {
+        response = m_inner.get(url, params, headers);
+        promise.set_value(response);
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inFlight.erase(key);
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inFlight.erase(key);
+    return response;
+}
+
+HttpResponse CoalescingHttpClient::request(const HttpRequest& request) {
+    if (request.isPlainGet()) {
+        return get(request.url, request.params, request.headers);
+    }
+    return m_inner.request(request);
+}
+
+HttpCoalescingStats CoalescingHttpClient::getStats() const {
+    HttpCoalescingStats stats{m_transfers.load(), m_coalesced.load(), 0};
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.maxWaiters = m_maxWaiters;
+    return stats;
+}
+
+std::map<std::string, size_t> CoalescingHttpClient::getWaiterCounts() {
+    std::map<std::string, size_t> counts;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_inFlight) {
+        counts[entry.first] = entry.second->waiters;
+    }
+    return counts;
+}
+
+std::string CoalescingHttpClient::makeKey(const std::string& url,
+                                          const std::map<std::string, std::string>& params,
+                                          const std::map<std::string, std::string>& headers) {
+    return makeRequestKey(url, params, headers);
+}
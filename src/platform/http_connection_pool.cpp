@@ -0,0 +1,158 @@
+#include "platform/http_connection_pool.hpp"
+#include <curl/curl.h>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+HttpConnectionPool::HttpConnectionPool(size_t maxPerHost, std::chrono::seconds idleTimeout)
+    : m_share(nullptr)
+    , m_maxPerHost(maxPerHost)
+    , m_idleTimeout(idleTimeout)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+{
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_idle) {
+        for (auto& idle : entry.second) {
+            curl_easy_cleanup(idle.handle);
+        }
+    }
+    m_idle.clear();
+}
+
+CURL* HttpConnectionPool::acquire(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        evictIdleLocked(std::chrono::steady_clock::now());
+        auto it = m_idle.find(key);
+        if (it != m_idle.end() && !it->second.empty()) {
+            // Most recently used first: its connection is the least likely to have been closed by the server
+            CURL* handle = it->second.back().handle;
+            it->second.pop_back();
+            m_hits++;
+            curl_easy_reset(handle);
+            if (m_share) {
+                curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+            }
+            return handle;
+        }
+    }
+
+    m_misses++;
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        throw std::runtime_error("Failed to initialize CURL");
+    }
+    CURLSH* share = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        share = m_share;
+    }
+    if (share) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    }
+    return handle;
+}
+
+void HttpConnectionPool::release(const std::string& key, CURL* handle) {
+    if (!handle) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<IdleHandle>& idle = m_idle[key];
+        if (idle.size() < m_maxPerHost) {
+            idle.push_back({handle, std::chrono::steady_clock::now()});
+            return;
+        }
+    }
+    curl_easy_cleanup(handle);
+}
+
+void HttpConnectionPool::evictIdle() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evictIdleLocked(std::chrono::steady_clock::now());
+}
+
+void HttpConnectionPool::evictIdleLocked(std::chrono::steady_clock::time_point now) {
+    for (auto it = m_idle.begin(); it != m_idle.end();) {
+        std::vector<IdleHandle>& idle = it->second;
+        // Handles are appended on release, so the stalest ones are at the front
+        size_t expired = 0;
+        while (expired < idle.size() && now - idle[expired].lastUsed > m_idleTimeout) {
+            curl_easy_cleanup(idle[expired].handle);
+            expired++;
+        }
+        if (expired > 0) {
+            idle.erase(idle.begin(), idle.begin() + expired);
+            m_evictions += expired;
+        }
+        if (idle.empty()) {
+            it = m_idle.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void HttpConnectionPool::setShare(CURLSH* share) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_share = share;
+}
+
+void HttpConnectionPool::setMaxPerHost(size_t maxPerHost) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxPerHost = maxPerHost;
+    for (auto& entry : m_idle) {
+        std::vector<IdleHandle>& idle = entry.second;
+        while (idle.size() > m_maxPerHost) {
+            curl_easy_cleanup(idle.front().handle);
+            idle.erase(idle.begin());
+            m_evictions++;
+        }
+    }
+}
+
+void HttpConnectionPool::setIdleTimeout(std::chrono::seconds idleTimeout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idleTimeout = idleTimeout;
+}
+
+size_t HttpConnectionPool::getIdleCount() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (const auto& entry : m_idle) {
+        count += entry.second.size();
+    }
+    return count;
+}
+
+std::string HttpConnectionPool::makeKey(const std::string& url) {
+    CURLU* parsed = curl_url();
+    if (!parsed) {
+        return url;
+    }
+    std::string key = url;
+    if (curl_url_set(parsed, CURLUPART_URL, url.c_str(), CURLU_GUESS_SCHEME) == CURLUE_OK) {
+        char* scheme = nullptr;
+        char* host = nullptr;
+        char* port = nullptr;
+        curl_url_get(parsed, CURLUPART_SCHEME, &scheme, 0);
+        curl_url_get(parsed, CURLUPART_HOST, &host, 0);
+        curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT);
+        if (scheme && host) {
+            key = std::string(scheme) + "://" + host + ":" + (port ? port : "");
+            std::transform(key.begin(), key.end(), key.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        }
+        curl_free(scheme);
+        curl_free(host);
+        curl_free(port);
+    }
+    curl_url_cleanup(parsed);
+    return key;
+}
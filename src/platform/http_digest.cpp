@@ -0,0 +1,55 @@
+#include "platform/http_digest.hpp"
+#include <openssl/evp.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+static std::string toHex(const unsigned char* digest, unsigned int length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(length * 2);
+    for (unsigned int i = 0; i < length; ++i) {
+        hex.push_back(digits[digest[i] >> 4]);
+        hex.push_back(digits[digest[i] & 0x0f]);
+    }
+    return hex;
+}
+
+std::string sha256Hex(std::string_view data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    if (EVP_Digest(data.data(), data.size(), digest, &digestLength, EVP_sha256(), nullptr) != 1) {
+        throw std::runtime_error("Failed to compute SHA-256");
+    }
+    return toHex(digest, digestLength);
+}
+
+std::string sha256FileHex(const std::string& path) {
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path + " for hashing");
+    }
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    if (!context || EVP_DigestInit_ex(context.get(), EVP_sha256(), nullptr) != 1) {
+        throw std::runtime_error("Failed to initialize SHA-256");
+    }
+    std::vector<char> buffer(1024 * 1024);
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (file.gcount() > 0
+            && EVP_DigestUpdate(context.get(), buffer.data(), static_cast<size_t>(file.gcount())) != 1) {
+            throw std::runtime_error("Failed to compute SHA-256 of " + path);
+        }
+    }
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read " + path + " for hashing");
+    }
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    if (EVP_DigestFinal_ex(context.get(), digest, &digestLength) != 1) {
+        throw std::runtime_error("Failed to compute SHA-256 of " + path);
+    }
+    return toHex(digest, digestLength);
+}
@@ -0,0 +1,630 @@
+#include "platform/http_downloader.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_digest.hpp"
+#include "platform/logger.h"
+#include "platform/worker.hpp"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Positional writes into one file, so segments can land in any order and from
+// any thread without sharing a file offset
+class SegmentFile {
+public:
+    SegmentFile(const std::string& path, bool truncate);
+    ~SegmentFile();
+
+    SegmentFile(const SegmentFile&) = delete;
+    SegmentFile& operator=(const SegmentFile&) = delete;
+
+    uint64_t size() const;
+    // Sets the length and, where the platform allows, reserves the blocks so a full
+    // disk is reported now rather than halfway through the download
+    void resize(uint64_t length);
+    void writeAt(uint64_t offset, const char* data, size_t length);
+    void sync();
+
+private:
+    std::string m_path;
+#if defined(_WIN32)
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+#if defined(_WIN32)
+SegmentFile::SegmentFile(const std::string& path, bool truncate)
+    : m_path(path)
+{
+    m_handle = CreateFileW(std::filesystem::u8path(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                           nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open " + path + ": error " + std::to_string(GetLastError()));
+    }
+}
+
+SegmentFile::~SegmentFile() {
+    CloseHandle(m_handle);
+}
+
+uint64_t SegmentFile::size() const {
+    LARGE_INTEGER size;
+    return GetFileSizeEx(m_handle, &size) ? static_cast<uint64_t>(size.QuadPart) : 0;
+}
+
+void SegmentFile::resize(uint64_t length) {
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(length);
+    if (!SetFilePointerEx(m_handle, position, nullptr, FILE_BEGIN) || !SetEndOfFile(m_handle)) {
+        throw std::runtime_error("Failed to preallocate " + m_path + ": error " + std::to_string(GetLastError()));
+    }
+}
+
+void SegmentFile::writeAt(uint64_t offset, const char* data, size_t length) {
+    while (length > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 1u << 30));
+        DWORD written = 0;
+        if (!WriteFile(m_handle, data, chunk, &written, &overlapped)) {
+            throw std::runtime_error("Failed to write " + m_path + ": error " + std::to_string(GetLastError()));
+        }
+        offset += written;
+        data += written;
+        length -= written;
+    }
+}
+
+void SegmentFile::sync() {
+    if (!FlushFileBuffers(m_handle)) {
+        throw std::runtime_error("Failed to flush " + m_path + ": error " + std::to_string(GetLastError()));
+    }
+}
+#else
+SegmentFile::SegmentFile(const std::string& path, bool truncate)
+    : m_path(path)
+    , m_fd(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644))
+{
+    if (m_fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+}
+
+SegmentFile::~SegmentFile() {
+    ::close(m_fd);
+}
+
+uint64_t SegmentFile::size() const {
+    struct stat info;
+    return ::fstat(m_fd, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+void SegmentFile::resize(uint64_t length) {
+    if (::ftruncate(m_fd, static_cast<off_t>(length)) != 0) {
+        throw std::runtime_error("Failed to resize " + m_path + ": " + std::strerror(errno));
+    }
+#if defined(__linux__)
+    // Some filesystems can't reserve space; ftruncate alone is still correct there
+    int result = ::posix_fallocate(m_fd, 0, static_cast<off_t>(length));
+    if (result == ENOSPC) {
+        throw std::runtime_error("Not enough disk space for " + m_path);
+    }
+#endif
+}
+
+void SegmentFile::writeAt(uint64_t offset, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(m_fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write " + m_path + ": " + std::strerror(errno));
+        }
+        offset += static_cast<uint64_t>(written);
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+void SegmentFile::sync() {
+#if defined(__linux__)
+    int result = ::fdatasync(m_fd);
+#else
+    int result = ::fsync(m_fd);
+#endif
+    if (result != 0) {
+        throw std::runtime_error("Failed to flush " + m_path + ": " + std::strerror(errno));
+    }
+}
+#endif
+
+// Takes the part file writes off the engine's I/O thread, where sinks must not block
+// and a slow disk would stall every other transfer. Chunks are copied and written by
+// Worker threads; drain() helps with the backlog on the calling thread, so it can't
+// deadlock on a busy pool. Writes land at fixed offsets, so their order doesn't matter.
+// The ranged path drains after each segment, which bounds the backlog to the segments
+// in flight; a streamed download's backlog grows while the disk is slower than the network.
+class QueuedFileWriter {
+public:
+    explicit QueuedFileWriter(std::shared_ptr<SegmentFile> file)
+        : m_state(std::make_shared<State>())
+    {
+        m_state->file = std::move(file);
+    }
+
+    // Returns false, so the sink can stop its transfer, once a write has failed
+    bool write(uint64_t offset, std::string_view chunk) {
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            if (!m_state->error.empty()) {
+                return false;
+            }
+            m_state->pending.push_back({offset, std::string(chunk)});
+        }
+        std::shared_ptr<State> state = m_state;
+        Worker::getInstance().post([state]() { writeOne(*state); });
+        return true;
+    }
+
+    // Blocks until everything queued so far is on its way to the disk. Throws the first write error.
+    void drain() {
+        std::unique_lock<std::mutex> lock(m_state->mutex);
+        while (!m_state->pending.empty()) {
+            lock.unlock();
+            writeOne(*m_state);
+            lock.lock();
+        }
+        m_state->idle.wait(lock, [this] { return m_state->writing == 0; });
+        if (!m_state->error.empty()) {
+            throw std::runtime_error(m_state->error);
+        }
+    }
+
+private:
+    struct Pending {
+        uint64_t offset;
+        std::string data;
+    };
+
+    struct State {
+        std::shared_ptr<SegmentFile> file;
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::deque<Pending> pending;
+        size_t writing = 0;
+        std::string error; // First failure; later chunks are dropped
+    };
+
+    static void writeOne(State& state) {
+        Pending chunk;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.pending.empty()) {
+                return; // Already written by drain()
+            }
+            chunk = std::move(state.pending.front());
+            state.pending.pop_front();
+            if (!state.error.empty()) {
+                return;
+            }
+            state.writing++;
+        }
+        std::string error;
+        try {
+            state.file->writeAt(chunk.offset, chunk.data.data(), chunk.data.size());
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.error.empty()) {
+            state.error = error;
+        }
+        state.writing--;
+        state.idle.notify_all();
+    }
+
+    std::shared_ptr<State> m_state;
+};
+
+static std::string headerValue(const HttpResponse& response, std::string_view name) {
+    return std::string(response.headers.get(name));
+}
+
+static bool equalsIgnoreCase(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+static void removeFile(const std::string& path) {
+    std::error_code error;
+    std::filesystem::remove(std::filesystem::u8path(path), error);
+}
+
+// Verifies the finished part file and moves it into place. Bad data is deleted
+// together with the journal, since resuming would only reproduce it.
+static void finish(const std::string& partPath, const std::string& path, uint64_t length,
+                   const HttpDownloadOptions& options, HttpDownloadResult& result) {
+    const std::string journalPath = partPath + ".json";
+    std::error_code error;
+    uint64_t actual = std::filesystem::file_size(std::filesystem::u8path(partPath), error);
+    if (error || actual != length) {
+        removeFile(partPath);
+        removeFile(journalPath);
+        throw std::runtime_error("Downloaded " + std::to_string(actual) + " bytes, expected " + std::to_string(length));
+    }
+    if (!options.expectedSha256.empty()) {
+        result.sha256 = sha256FileHex(partPath);
+        if (!equalsIgnoreCase(result.sha256, options.expectedSha256)) {
+            removeFile(partPath);
+            removeFile(journalPath);
+            throw std::runtime_error("Checksum mismatch for " + path + ": got " + result.sha256
+                                     + ", expected " + options.expectedSha256);
+        }
+    }
+    // rename() won't replace an existing file everywhere
+    removeFile(path);
+    std::filesystem::rename(std::filesystem::u8path(partPath), std::filesystem::u8path(path), error);
+    if (error) {
+        throw std::runtime_error("Failed to move " + partPath + " to " + path + ": " + error.message());
+    }
+    removeFile(journalPath);
+}
+
+HttpDownloader::HttpDownloader(HttpClient& client)
+    : m_client(client)
+{
+}
+
+HttpDownloadResult HttpDownloader::download(const std::string& url,
+                                            const std::string& path,
+                                            const HttpDownloadOptions& options) {
+    const std::string partPath = path + ".part";
+    Probe info = probe(url, options);
+    if (options.expectedLength >= 0 && info.length >= 0 && info.length != options.expectedLength) {
+        throw std::runtime_error("Server reports " + std::to_string(info.length) + " bytes for " + url
+                                 + ", expected " + std::to_string(options.expectedLength));
+    }
+
+    HttpDownloadResult result;
+    if (info.acceptsRanges && info.length >= 0) {
+        result = downloadRanged(url, partPath, info, options);
+    } else {
+        LOG_INFO("%s doesn't serve byte ranges; downloading in one stream", url.c_str());
+        result = downloadStreamed(url, partPath, options);
+    }
+
+    uint64_t expected = result.length;
+    if (options.expectedLength >= 0) {
+        expected = static_cast<uint64_t>(options.expectedLength);
+    } else if (info.length >= 0) {
+        expected = static_cast<uint64_t>(info.length);
+    }
+    finish(partPath, path, expected, options, result);
+    return result;
+}
+
+HttpDownloader::Probe HttpDownloader::probe(const std::string& url, const HttpDownloadOptions& options) {
+    HttpRequest request;
+    request.method = "HEAD";
+    request.url = url;
+    request.headers = options.headers;
+    // Ranges address the encoded representation, so ask for the identity one
+    request.acceptCompressed = false;
+    request.priority = options.priority;
+    request.cancelToken = options.cancelToken;
+
+    Probe info;
+    HttpResponse response;
+    try {
+        response = m_client.request(request);
+    } catch (const std::exception& e) {
+        // Some servers reject HEAD outright; the streamed GET still works there
+        LOG_WARN("HEAD %s failed: %s", url.c_str(), e.what());
+        return info;
+    }
+    if (response.status_code < 200 || response.status_code >= 300) {
+        return info;
+    }
+
+    std::string length = headerValue(response, "content-length");
+    if (!length.empty()) {
+        try {
+            info.length = std::stoll(length);
+        } catch (const std::exception&) {
+            info.length = -1;
+        }
+    }
+    info.acceptsRanges = equalsIgnoreCase(headerValue(response, "accept-ranges"), "bytes");
+
+    // If-Range only takes strong validators
+    std::string etag = headerValue(response, "etag");
+    if (!etag.empty() && etag.compare(0, 2, "W/") != 0) {
+        info.validator = etag;
+    } else {
+        info.validator = headerValue(response, "last-modified");
+    }
+    return info;
+}
+
+HttpDownloadResult HttpDownloader::downloadRanged(const std::string& url, const std::string& partPath,
+                                                  const Probe& info, const HttpDownloadOptions& options) {
+    const std::string journalPath = partPath + ".json";
+    const uint64_t length = static_cast<uint64_t>(info.length);
+    const uint64_t segmentSize = std::max<uint64_t>(options.segmentSize, 1);
+    const size_t segmentCount = static_cast<size_t>((length + segmentSize - 1) / segmentSize);
+
+    nlohmann::json journal = {
+        {"url", url},
+        {"length", length},
+        {"validator", info.validator},
+        {"segment_size", segmentSize},
+        {"done", nlohmann::json::array()}
+    };
+    std::vector<bool> done(segmentCount, false);
+
+    // Resume only if the journal describes the same resource, cut the same way
+    bool resume = false;
+    {
+        std::ifstream file(std::filesystem::u8path(journalPath));
+        if (file.is_open()) {
+            try {
+                nlohmann::json saved;
+                file >> saved;
+                resume = saved.value("url", std::string()) == url
+                    && saved.value("length", static_cast<uint64_t>(0)) == length
+                    && saved.value("segment_size", static_cast<uint64_t>(0)) == segmentSize
+                    && !info.validator.empty()
+                    && saved.value("validator", std::string()) == info.validator;
+                if (resume) {
+                    for (const auto& index : saved.at("done")) {
+                        size_t segment = index.get<size_t>();
+                        if (segment < segmentCount) {
+                            done[segment] = true;
+                        }
+                    }
+                }
+            } catch (const nlohmann::json::exception& e) {
+                LOG_WARN("Ignoring unreadable download journal %s: %s", journalPath.c_str(), e.what());
+                resume = false;
+            }
+        }
+    }
+
+    // Shared with the segment sinks, which can outlive this call if it throws mid-batch
+    auto file = std::make_shared<SegmentFile>(partPath, !resume);
+    if (resume && file->size() != length) {
+        LOG_WARN("Partial file %s has the wrong size; starting over", partPath.c_str());
+        resume = false;
+        std::fill(done.begin(), done.end(), false);
+    }
+    if (!resume) {
+        file->resize(length);
+    }
+    auto writer = std::make_shared<QueuedFileWriter>(file);
+
+    HttpDownloadResult result;
+    result.length = length;
+    result.ranged = true;
+    uint64_t committed = 0;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        if (done[i]) {
+            journal["done"].push_back(i);
+            committed += std::min(segmentSize, length - i * segmentSize);
+        }
+    }
+    result.resumedBytes = committed;
+    if (resume && committed > 0) {
+        LOG_INFO("Resuming %s at %llu of %llu bytes", url.c_str(),
+                 static_cast<unsigned long long>(committed), static_cast<unsigned long long>(length));
+    }
+
+    auto saveJournal = [&]() {
+        std::string tmpPath = journalPath + ".tmp";
+        {
+            std::ofstream out(std::filesystem::u8path(tmpPath), std::ios::trunc);
+            out << journal.dump();
+            if (!out) {
+                throw std::runtime_error("Failed to write download journal " + tmpPath);
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(std::filesystem::u8path(tmpPath), std::filesystem::u8path(journalPath), error);
+        if (error) {
+            throw std::runtime_error("Failed to replace download journal " + journalPath + ": " + error.message());
+        }
+    };
+    if (!resume) {
+        saveJournal();
+    }
+
+    HttpRetryPolicy policy = m_client.getRetryPolicy();
+    policy.attemptTimeout = options.segmentTimeout;
+
+    std::string lastError;
+    for (int attempt = 0; attempt < std::max(options.maxAttempts, 1); ++attempt) {
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < segmentCount; ++i) {
+            if (!done[i]) {
+                missing.push_back(i);
+            }
+        }
+        if (missing.empty() || (options.cancelToken && options.cancelToken->isCancelled())) {
+            break;
+        }
+
+        // Bytes each transfer has written so far; a sink only ever touches its own entry
+        auto written = std::make_shared<std::vector<uint64_t>>(missing.size(), 0);
+        // Stops this attempt's transfers if we bail out while some are still running
+        auto abandoned = std::make_shared<HttpCancelToken>();
+        std::vector<HttpRequest> requests;
+        requests.reserve(missing.size());
+        for (size_t slot = 0; slot < missing.size(); ++slot) {
+            const uint64_t first = missing[slot] * segmentSize;
+            const uint64_t size = std::min(segmentSize, length - first);
+            HttpRequest request;
+            request.url = url;
+            request.headers = options.headers;
+            request.headers["Range"] = "bytes=" + std::to_string(first) + "-" + std::to_string(first + size - 1);
+            if (!info.validator.empty()) {
+                request.headers["If-Range"] = info.validator;
+            }
+            request.acceptCompressed = false;
+            request.priority = options.priority;
+            request.cancelToken = options.cancelToken;
+            request.retryPolicy = policy;
+            // Only a 206 carries this segment's bytes: a 200 would write the start of the
+            // whole file at `first`, and error pages don't belong in the file either.
+            // Failed segments are fetched again by the next pass.
+            request.checkResponse = [](int status, const HttpHeaders&) { return status == 206; };
+            request.sink = [writer, written, abandoned, slot, first, size](std::string_view chunk) {
+                if (abandoned->isCancelled()) {
+                    return false;
+                }
+                uint64_t& offset = (*written)[slot];
+                // A 206 longer than asked for must not spill into the next segment
+                if (offset + chunk.size() > size) {
+                    return false;
+                }
+                if (!writer->write(first + offset, chunk)) {
+                    return false;
+                }
+                offset += chunk.size();
+                return true;
+            };
+            requests.push_back(std::move(request));
+        }
+
+        bool changed = false;
+        bool rangesIgnored = false;
+        HttpBatchOptions batchOptions;
+        batchOptions.maxParallel = std::max<size_t>(options.parallelSegments, 1);
+        batchOptions.maxPerHost = batchOptions.maxParallel;
+        batchOptions.onResult = [&](size_t slot, const HttpResult& segmentResult) {
+            const size_t segment = missing[slot];
+            const uint64_t size = std::min(segmentSize, length - segment * segmentSize);
+            if (!segmentResult.ok()) {
+                lastError = segmentResult.error;
+                return;
+            }
+            if (segmentResult.response.status_code != 206) {
+                // With If-Range a 200 means the resource changed since the probe; without
+                // one, the server just ignores Range despite its Accept-Ranges
+                if (segmentResult.response.status_code == 200 && info.validator.empty()) {
+                    rangesIgnored = true;
+                } else if (segmentResult.response.status_code == 200) {
+                    changed = true;
+                }
+                lastError = "Segment " + std::to_string(segment) + " answered with status "
+                    + std::to_string(segmentResult.response.status_code);
+                return;
+            }
+            if ((*written)[slot] != size) {
+                lastError = "Segment " + std::to_string(segment) + " is " + std::to_string((*written)[slot])
+                    + " bytes, expected " + std::to_string(size);
+                return;
+            }
+            // The data has to be on disk before the journal may claim it
+            writer->drain();
+            file->sync();
+            done[segment] = true;
+            journal["done"].push_back(segment);
+            saveJournal();
+            result.segments++;
+            committed += size;
+            if (options.onProgress) {
+                options.onProgress(committed, length);
+            }
+        };
+        try {
+            m_client.getBatch(std::move(requests), batchOptions);
+            // Failed segments may still have writes queued; the next pass rewrites the same bytes
+            writer->drain();
+        } catch (...) {
+            abandoned->cancel();
+            throw;
+        }
+
+        if (changed) {
+            removeFile(journalPath);
+            throw std::runtime_error(url + " changed during the download; it will restart from the beginning");
+        }
+        if (rangesIgnored) {
+            LOG_INFO("%s ignores Range requests; downloading in one stream", url.c_str());
+            writer.reset();
+            file.reset();
+            return downloadStreamed(url, partPath, options);
+        }
+    }
+
+    if (std::find(done.begin(), done.end(), false) != done.end()) {
+        throw std::runtime_error("Download of " + url + " incomplete after " + std::to_string(options.maxAttempts)
+                                 + " attempts: " + lastError);
+    }
+    file->sync();
+    return result;
+}
+
+HttpDownloadResult HttpDownloader::downloadStreamed(const std::string& url, const std::string& partPath,
+                                                    const HttpDownloadOptions& options) {
+    // Nothing to resume without ranges
+    removeFile(partPath + ".json");
+    auto file = std::make_shared<SegmentFile>(partPath, true);
+    auto writer = std::make_shared<QueuedFileWriter>(file);
+    auto written = std::make_shared<std::atomic<uint64_t>>(0);
+
+    HttpRequest request;
+    request.url = url;
+    request.headers = options.headers;
+    request.acceptCompressed = false;
+    request.priority = options.priority;
+    request.cancelToken = options.cancelToken;
+    HttpRetryPolicy policy = m_client.getRetryPolicy();
+    policy.attemptTimeout = options.segmentTimeout;
+    request.retryPolicy = policy;
+    request.sink = [writer, written](std::string_view chunk) {
+        if (!writer->write(written->load(), chunk)) {
+            return false;
+        }
+        written->fetch_add(chunk.size());
+        return true;
+    };
+
+    HttpResponse response = m_client.request(request);
+    writer->drain();
+    if (response.status_code != 200) {
+        throw std::runtime_error("Download of " + url + " failed with status " + std::to_string(response.status_code));
+    }
+    file->sync();
+
+    HttpDownloadResult result;
+    result.length = written->load();
+    if (options.onProgress) {
+        options.onProgress(result.length, result.length);
+    }
+    return result;
+}
@@ -0,0 +1,385 @@
+#include "platform/http_event_stream.hpp"
+#include "platform/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+using Clock = std::chrono::steady_clock;
+
+// Media type without parameters, compared case-insensitively
+static bool hasMediaType(std::string_view contentType, std::string_view expected) {
+    contentType = contentType.substr(0, contentType.find(';'));
+    while (!contentType.empty() && std::isspace(static_cast<unsigned char>(contentType.back()))) {
+        contentType.remove_suffix(1);
+    }
+    return contentType.size() == expected.size()
+        && std::equal(contentType.begin(), contentType.end(), expected.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+HttpEventStreamParser::HttpEventStreamParser(HttpEventStreamFormat format, EventHandler onEvent)
+    : m_format(format)
+    , m_onEvent(std::move(onEvent))
+    , m_afterCR(false)
+    , m_atStart(true)
+    , m_hasData(false)
+    , m_retry(0)
+{
+}
+
+void HttpEventStreamParser::write(std::string_view chunk) {
+    size_t i = 0;
+    while (i < chunk.size()) {
+        if (m_afterCR) {
+            m_afterCR = false;
+            if (chunk[i] == '\n') {
+                i++;
+                continue;
+            }
+        }
+        size_t end = chunk.find_first_of("\r\n", i);
+        if (end == std::string_view::npos) {
+            m_line.append(chunk.data() + i, chunk.size() - i);
+            return;
+        }
+        m_afterCR = chunk[end] == '\r';
+        if (m_line.empty()) {
+            // The whole line is in this chunk: no copy needed
+            line(chunk.substr(i, end - i));
+        } else {
+            m_line.append(chunk.data() + i, end - i);
+            line(m_line);
+            m_line.clear();
+        }
+        i = end + 1;
+    }
+}
+
+void HttpEventStreamParser::reset() {
+    m_line.clear();
+    m_afterCR = false;
+    m_atStart = true;
+    m_type.clear();
+    m_data.clear();
+    m_hasData = false;
+}
+
+void HttpEventStreamParser::line(std::string_view text) {
+    if (m_atStart) {
+        m_atStart = false;
+        if (text.substr(0, 3) == "\xEF\xBB\xBF") {
+            text.remove_prefix(3);
+        }
+    }
+
+    if (m_format == HttpEventStreamFormat::NdJson) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
+        }
+        if (text.empty()) {
+            return;
+        }
+        HttpStreamEvent event;
+        event.json = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+        if (event.json.is_discarded()) {
+            LOG_WARN("Skipping invalid JSON line in event stream");
+            return;
+        }
+        event.data.assign(text.data(), text.size());
+        m_onEvent(std::move(event));
+        return;
+    }
+
+    if (text.empty()) {
+        dispatch();
+        return;
+    }
+    if (text.front() == ':') {
+        return; // Comment, typically a heartbeat
+    }
+    size_t colon = text.find(':');
+    std::string_view field = text.substr(0, colon);
+    std::string_view value;
+    if (colon != std::string_view::npos) {
+        value = text.substr(colon + 1);
+        if (!value.empty() && value.front() == ' ') {
+            value.remove_prefix(1);
+        }
+    }
+
+    if (field == "event") {
+        m_type.assign(value.data(), value.size());
+    } else if (field == "data") {
+        m_data.append(value.data(), value.size());
+        m_data += '\n';
+        m_hasData = true;
+    } else if (field == "id") {
+        if (value.find('\0') == std::string_view::npos) {
+            m_lastEventId.assign(value.data(), value.size());
+        }
+    } else if (field == "retry") {
+        // Digits only; values that don't fit are ignored like any other invalid one
+        long long milliseconds = 0;
+        if (!value.empty() && std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; })
+            && std::from_chars(value.data(), value.data() + value.size(), milliseconds).ec == std::errc()) {
+            m_retry = std::chrono::milliseconds(milliseconds);
+        }
+    }
+    // Other fields are ignored
+}
+
+void HttpEventStreamParser::dispatch() {
+    if (!m_hasData) {
+        m_type.clear();
+        return;
+    }
+    HttpStreamEvent event;
+    if (!m_type.empty()) {
+        event.type = std::move(m_type);
+    }
+    m_data.pop_back(); // The '\n' after the last data line
+    event.data = std::move(m_data);
+    event.id = m_lastEventId;
+    m_type.clear();
+    m_data.clear();
+    m_hasData = false;
+    m_onEvent(std::move(event));
+}
+
+HttpEventSubscription::HttpEventSubscription(HttpClient& client,
+                                             const std::string& url,
+                                             EventsHandler onEvents,
+                                             const HttpEventStreamOptions& options,
+                                             ErrorHandler onError)
+    : m_client(client)
+    , m_url(url)
+    , m_options(options)
+    , m_delivery(std::make_shared<Delivery>())
+    , m_parser(options.format, [this](HttpStreamEvent&& event) { m_parsed.push_back(std::move(event)); })
+    , m_lastActivity(0)
+    , m_ioThread(std::thread::id())
+    , m_closed(false)
+    , m_connected(false)
+    , m_eventCount(0)
+    , m_reconnects(0)
+{
+    m_delivery->onEvents = std::move(onEvents);
+    m_delivery->onError = std::move(onError);
+    m_thread = std::thread(&HttpEventSubscription::run, this);
+}
+
+HttpEventSubscription::~HttpEventSubscription() {
+    close();
+}
+
+void HttpEventSubscription::close() {
+    m_closed = true;
+    {
+        std::lock_guard<std::mutex> lock(m_delivery->mutex);
+        m_delivery->closed = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_connection) {
+            m_connection->cancel();
+        }
+    }
+    m_wake.notify_all();
+    // Called from a handler without a dispatcher: onError runs on m_thread itself and
+    // onEvents on the I/O thread run() is waiting on. run() exits on its own once
+    // the request ends; the destructor joins it.
+    const std::thread::id self = std::this_thread::get_id();
+    if (self == m_thread.get_id() || self == m_ioThread.load()) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::string HttpEventSubscription::getLastEventId() {
+    std::lock_guard<std::mutex> lock(m_parserMutex);
+    return m_parser.getLastEventId();
+}
+
+void HttpEventSubscription::run() {
+    std::chrono::milliseconds failureDelay = m_options.reconnectDelay;
+    bool firstConnection = true;
+    while (!m_closed) {
+        auto token = std::make_shared<HttpCancelToken>();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed) {
+                break;
+            }
+            m_connection = token;
+        }
+        if (!firstConnection) {
+            m_reconnects++;
+        }
+        firstConnection = false;
+
+        HttpRequest request;
+        request.url = m_url;
+        request.headers = m_options.headers;
+        request.headers["Accept"] = m_options.format == HttpEventStreamFormat::ServerSentEvents
+            ? "text/event-stream" : "application/x-ndjson";
+        request.headers["Cache-Control"] = "no-cache";
+        {
+            std::lock_guard<std::mutex> lock(m_parserMutex);
+            m_parser.reset();
+            if (!m_parser.getLastEventId().empty()) {
+                request.headers["Last-Event-ID"] = m_parser.getLastEventId();
+            }
+        }
+        // Error bodies and non-SSE answers are never parsed: a JSON error would pass as an NDJSON event
+        std::string rejected;
+        request.checkResponse = [this, &rejected](int status, const HttpHeaders& headers) {
+            if (status < 200 || status >= 300) {
+                return false; // Reported from the status below
+            }
+            std::string_view type = headers.get("content-type");
+            if (m_options.format == HttpEventStreamFormat::ServerSentEvents && !hasMediaType(type, "text/event-stream")) {
+                rejected = "Unexpected Content-Type \"" + std::string(type) + "\"";
+                return false;
+            }
+            return true;
+        };
+        request.sink = [this](std::string_view chunk) {
+            m_ioThread = std::this_thread::get_id();
+            m_lastActivity = Clock::now().time_since_epoch().count();
+            m_connected = true;
+            std::vector<HttpStreamEvent> events;
+            {
+                std::lock_guard<std::mutex> lock(m_parserMutex);
+                m_parser.write(chunk);
+                events.swap(m_parsed);
+            }
+            // Outside the parser lock: without a dispatcher onEvents runs right here,
+            // and it may well call getLastEventId()
+            if (!events.empty()) {
+                enqueue(std::move(events));
+            }
+            return true;
+        };
+        request.cancelToken = token;
+        request.longLived = true;
+        HttpRetryPolicy policy;
+        policy.maxAttempts = 1; // Reconnection is handled here, with Last-Event-ID
+        policy.attemptTimeout = std::chrono::milliseconds(0);
+        request.retryPolicy = policy;
+
+        const uint64_t eventsBefore = m_eventCount.load();
+        m_lastActivity = Clock::now().time_since_epoch().count();
+        std::future<HttpResponse> future = m_client.requestAsync(std::move(request));
+
+        bool idle = false;
+        if (m_options.idleTimeout.count() > 0) {
+            const auto check = std::max(m_options.idleTimeout / 4, std::chrono::milliseconds(10));
+            while (future.wait_for(check) != std::future_status::ready) {
+                Clock::time_point last{Clock::duration(m_lastActivity.load())};
+                if (!idle && Clock::now() - last > m_options.idleTimeout) {
+                    idle = true;
+                    token->cancel();
+                }
+            }
+        } else {
+            future.wait();
+        }
+
+        std::string error;
+        int status = 0;
+        try {
+            status = future.get().status_code;
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        m_connected = false;
+        if (m_closed) {
+            break;
+        }
+        if (idle) {
+            error = "No data for " + std::to_string(m_options.idleTimeout.count()) + " ms";
+        } else if (error.empty() && status == 204) {
+            LOG_INFO("Event stream %s ended by the server", m_url.c_str());
+            m_closed = true;
+            break;
+        } else if (error.empty() && (status < 200 || status >= 300)) {
+            error = "HTTP status " + std::to_string(status);
+        } else if (error.empty() && !rejected.empty()) {
+            error = rejected;
+        }
+
+        std::chrono::milliseconds delay;
+        if (error.empty() || m_eventCount.load() > eventsBefore) {
+            // The connection worked; a plain end of stream reconnects after the normal delay
+            std::lock_guard<std::mutex> lock(m_parserMutex);
+            delay = m_parser.getRetryDelay().count() > 0 ? m_parser.getRetryDelay() : m_options.reconnectDelay;
+            failureDelay = m_options.reconnectDelay;
+        } else {
+            delay = failureDelay;
+            failureDelay = std::min(failureDelay * 2, m_options.maxReconnectDelay);
+        }
+        if (!error.empty()) {
+            LOG_WARN("Event stream %s: %s; reconnecting in %lld ms", m_url.c_str(), error.c_str(),
+                     static_cast<long long>(delay.count()));
+            reportError(error);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_connection.reset();
+        m_wake.wait_for(lock, delay, [this] { return m_closed.load(); });
+    }
+}
+
+void HttpEventSubscription::enqueue(std::vector<HttpStreamEvent>&& events) {
+    m_eventCount += events.size();
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(m_delivery->mutex);
+        if (m_delivery->closed) {
+            return;
+        }
+        for (HttpStreamEvent& event : events) {
+            m_delivery->events.push_back(std::move(event));
+        }
+        schedule = !m_delivery->scheduled;
+        m_delivery->scheduled = true;
+    }
+    if (!schedule) {
+        return;
+    }
+    // One task per frame at most: later events join the batch this task will pick up
+    std::shared_ptr<Delivery> delivery = m_delivery;
+    m_client.dispatchToMainThread([delivery]() {
+        std::vector<HttpStreamEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(delivery->mutex);
+            events.swap(delivery->events);
+            delivery->scheduled = false;
+            if (delivery->closed) {
+                return;
+            }
+        }
+        if (!events.empty() && delivery->onEvents) {
+            delivery->onEvents(std::move(events));
+        }
+    });
+}
+
+void HttpEventSubscription::reportError(const std::string& error) {
+    std::shared_ptr<Delivery> delivery = m_delivery;
+    if (!delivery->onError) {
+        return;
+    }
+    m_client.dispatchToMainThread([delivery, error]() {
+        {
+            std::lock_guard<std::mutex> lock(delivery->mutex);
+            if (delivery->closed) {
+                return;
+            }
+        }
+        delivery->onError(error);
+    });
+}
@@ -0,0 +1,114 @@
+#include "platform/http_headers.hpp"
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i];
+        char y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r' || text.back() == '\n')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+HttpHeaders HttpHeaders::parse(std::string_view block) {
+    HttpHeaders headers;
+    while (!block.empty()) {
+        size_t end = block.find('\n');
+        headers.addLine(block.substr(0, end));
+        block.remove_prefix(end == std::string_view::npos ? block.size() : end + 1);
+    }
+    return headers;
+}
+
+std::optional<std::string_view> HttpHeaders::find(std::string_view name) const {
+    for (const Span& span : m_fields) {
+        if (equalsIgnoreCase(std::string_view(m_buffer.data() + span.nameOffset, span.nameLength), name)) {
+            return std::string_view(m_buffer.data() + span.valueOffset, span.valueLength);
+        }
+    }
+    return std::nullopt;
+}
+
+size_t HttpHeaders::count(std::string_view name) const {
+    size_t matches = 0;
+    for (const Span& span : m_fields) {
+        if (equalsIgnoreCase(std::string_view(m_buffer.data() + span.nameOffset, span.nameLength), name)) {
+            matches++;
+        }
+    }
+    return matches;
+}
+
+HttpHeaders::Field HttpHeaders::field(size_t index) const {
+    const Span& span = m_fields[index];
+    return Field{std::string_view(m_buffer.data() + span.nameOffset, span.nameLength),
+                 std::string_view(m_buffer.data() + span.valueOffset, span.valueLength)};
+}
+
+void HttpHeaders::addLine(std::string_view line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+        line.remove_suffix(1);
+    }
+    if (line.substr(0, 5) == "HTTP/") {
+        clear();
+        m_buffer.append(line).append("\r\n");
+        m_statusLength = m_buffer.size();
+        return;
+    }
+    // Blank line ending the block, or an obsolete folded continuation line
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0 || line.front() == ' ' || line.front() == '\t') {
+        return;
+    }
+    add(line.substr(0, colon), line.substr(colon + 1));
+}
+
+void HttpHeaders::add(std::string_view name, std::string_view value) {
+    name = trim(name);
+    value = trim(value);
+    Span span;
+    span.nameOffset = static_cast<uint32_t>(m_buffer.size());
+    span.nameLength = static_cast<uint32_t>(name.size());
+    span.valueOffset = span.nameOffset + span.nameLength + 2;
+    span.valueLength = static_cast<uint32_t>(value.size());
+    m_buffer.append(name).append(": ").append(value).append("\r\n");
+    m_fields.push_back(span);
+}
+
+void HttpHeaders::merge(const HttpHeaders& newer) {
+    HttpHeaders merged;
+    merged.m_buffer.reserve(m_buffer.size() + newer.m_buffer.size());
+    merged.m_buffer.append(m_buffer, 0, m_statusLength);
+    merged.m_statusLength = m_statusLength;
+    for (Field kept : *this) {
+        if (!newer.contains(kept.name)) {
+            merged.add(kept.name, kept.value);
+        }
+    }
+    for (Field field : newer) {
+        merged.add(field.name, field.value);
+    }
+    *this = std::move(merged);
+}
+
+void HttpHeaders::clear() {
+    m_buffer.clear();
+    m_statusLength = 0;
+    m_fields.clear();
+}
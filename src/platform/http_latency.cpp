@@ -0,0 +1,216 @@
+#include "platform/http_latency.hpp"
+#include <algorithm>
+#include <limits>
+
+// Values below kLinearLimit get a bucket each; above it every power of two is
+// split into kSubBuckets buckets.
+static const uint64_t kLinearLimit = 32;
+static const uint64_t kSubBuckets = 16;
+static const int kMaxShift = 36; // 16 << 36 µs is about 12 days; larger values are clamped
+static const size_t kBucketCount = kLinearLimit + kMaxShift * kSubBuckets;
+
+static int highestBit(uint64_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+HttpLatencyHistogram::HttpLatencyHistogram()
+    : m_buckets(kBucketCount, 0)
+    , m_count(0)
+    , m_min(std::numeric_limits<uint64_t>::max())
+    , m_max(0)
+    , m_sum(0.0)
+{
+}
+
+size_t HttpLatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < kLinearLimit) {
+        return static_cast<size_t>(value);
+    }
+    // Shift so that the value's top bits land in [kSubBuckets, 2 * kSubBuckets)
+    int shift = highestBit(value) - 4;
+    if (shift > kMaxShift) {
+        return kBucketCount - 1;
+    }
+    uint64_t subBucket = (value >> shift) - kSubBuckets;
+    return static_cast<size_t>(kLinearLimit + (shift - 1) * kSubBuckets + subBucket);
+}
+
+uint64_t HttpLatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < kLinearLimit) {
+        return index;
+    }
+    int shift = static_cast<int>((index - kLinearLimit) / kSubBuckets) + 1;
+    uint64_t subBucket = (index - kLinearLimit) % kSubBuckets + kSubBuckets;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void HttpLatencyHistogram::record(std::chrono::microseconds value) {
+    uint64_t micros = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+    m_buckets[bucketIndex(micros)]++;
+    m_count++;
+    m_min = std::min(m_min, micros);
+    m_max = std::max(m_max, micros);
+    m_sum += static_cast<double>(micros);
+}
+
+void HttpLatencyHistogram::merge(const HttpLatencyHistogram& other) {
+    if (other.m_count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+void HttpLatencyHistogram::clear() {
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_min = std::numeric_limits<uint64_t>::max();
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+std::chrono::microseconds HttpLatencyHistogram::getMin() const {
+    return std::chrono::microseconds(m_count > 0 ? m_min : 0);
+}
+
+double HttpLatencyHistogram::getMeanMicros() const {
+    return m_count > 0 ? m_sum / static_cast<double>(m_count) : 0.0;
+}
+
+std::chrono::microseconds HttpLatencyHistogram::percentile(double fraction) const {
+    if (m_count == 0) {
+        return std::chrono::microseconds(0);
+    }
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(m_count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            if (i == kBucketCount - 1) {
+                // Clamped values: the last bucket has no real upper bound
+                return std::chrono::microseconds(m_max);
+            }
+            // The bucket bound can overshoot the largest sample actually seen
+            return std::chrono::microseconds(std::min(bucketUpperBound(i), m_max));
+        }
+    }
+    return std::chrono::microseconds(m_max);
+}
+
+nlohmann::json HttpLatencyHistogram::toJson() const {
+    nlohmann::json buckets = nlohmann::json::array();
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        if (m_buckets[i] > 0) {
+            buckets.push_back({bucketUpperBound(i), m_buckets[i]});
+        }
+    }
+    return {
+        {"count", m_count},
+        {"min_us", getMin().count()},
+        {"max_us", getMax().count()},
+        {"mean_us", getMeanMicros()},
+        {"p50_us", percentile(0.50).count()},
+        {"p90_us", percentile(0.90).count()},
+        {"p95_us", percentile(0.95).count()},
+        {"p99_us", percentile(0.99).count()},
+        {"p999_us", percentile(0.999).count()},
+        {"buckets", buckets}
+    };
+}
+
+HttpLatencyTracker::HttpLatencyTracker(std::chrono::seconds window, size_t slots)
+    : m_slotLength(std::chrono::duration_cast<std::chrono::steady_clock::duration>(window) / std::max<size_t>(slots, 1))
+    , m_slotCount(std::max<size_t>(slots, 1))
+{
+}
+
+int64_t HttpLatencyTracker::currentEpoch() const {
+    return static_cast<int64_t>(std::chrono::steady_clock::now().time_since_epoch() / m_slotLength);
+}
+
+void HttpLatencyTracker::record(const std::string& host, const HttpTiming& timing) {
+    const int64_t epoch = currentEpoch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Slot>& slots = m_hosts[host];
+    if (slots.empty()) {
+        slots.resize(m_slotCount);
+    }
+    Slot& slot = slots[static_cast<size_t>(epoch % static_cast<int64_t>(m_slotCount))];
+    if (slot.epoch != epoch) {
+        // The slot last held an interval that has left the window
+        slot.epoch = epoch;
+        slot.total.clear();
+        slot.ttfb.clear();
+    }
+    slot.total.record(timing.total);
+    slot.ttfb.record(timing.start_transfer);
+}
+
+void HttpLatencyTracker::collectLocked(const std::vector<Slot>& slots, int64_t epoch,
+                                       HttpLatencyHistogram* total, HttpLatencyHistogram* ttfb) const {
+    for (const Slot& slot : slots) {
+        if (slot.epoch < 0 || epoch - slot.epoch >= static_cast<int64_t>(m_slotCount)) {
+            continue;
+        }
+        if (total) {
+            total->merge(slot.total);
+        }
+        if (ttfb) {
+            ttfb->merge(slot.ttfb);
+        }
+    }
+}
+
+HttpLatencyHistogram HttpLatencyTracker::getTotal(const std::string& host) {
+    HttpLatencyHistogram histogram;
+    const int64_t epoch = currentEpoch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_hosts.find(host);
+    if (it != m_hosts.end()) {
+        collectLocked(it->second, epoch, &histogram, nullptr);
+    }
+    return histogram;
+}
+
+HttpLatencyHistogram HttpLatencyTracker::getTimeToFirstByte(const std::string& host) {
+    HttpLatencyHistogram histogram;
+    const int64_t epoch = currentEpoch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_hosts.find(host);
+    if (it != m_hosts.end()) {
+        collectLocked(it->second, epoch, nullptr, &histogram);
+    }
+    return histogram;
+}
+
+std::vector<std::string> HttpLatencyTracker::getHosts() {
+    std::vector<std::string> hosts;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_hosts) {
+        hosts.push_back(entry.first);
+    }
+    return hosts;
+}
+
+nlohmann::json HttpLatencyTracker::toJson() {
+    nlohmann::json result = nlohmann::json::object();
+    const int64_t epoch = currentEpoch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_hosts) {
+        HttpLatencyHistogram total;
+        HttpLatencyHistogram ttfb;
+        collectLocked(entry.second, epoch, &total, &ttfb);
+        result[entry.first] = {{"total", total.toJson()}, {"ttfb", ttfb.toJson()}};
+    }
+    return result;
+}
@@ -0,0 +1,143 @@
+#include "platform/http_rate_limiter.hpp"
+#include <algorithm>
+
+RateLimitingHttpClient::RateLimitingHttpClient(IHttpClient& inner, const HttpRateLimit& defaultLimit)
+    : m_inner(inner)
+    , m_defaultLimit(defaultLimit)
+{
+}
+
+template <typename Send>
+HttpResponse RateLimitingHttpClient::throttle(const std::string& url, Send send) {
+    const std::string host = HttpConnectionPool::makeKey(url);
+    acquire(host);
+    HttpResponse response;
+    try {
+        response = send();
+    } catch (...) {
+        release(host, nullptr);
+        throw;
+    }
+    release(host, &response);
+    return response;
+}
+
+HttpResponse RateLimitingHttpClient::get(const std::string& url,
+                                         const std::map<std::string, std::string>& params,
+                                         const std::map<std::string, std::string>& headers) {
+    return throttle(url, [&]() { return m_inner.get(url, params, headers); });
+}
+
+HttpResponse RateLimitingHttpClient::request(const HttpRequest& request) {
+    return throttle(request.url, [&]() { return m_inner.request(request); });
+}
+
+void RateLimitingHttpClient::setHostLimit(const std::string& url, const HttpRateLimit& limit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Host& host = hostLocked(HttpConnectionPool::makeKey(url));
+    refill(host, Clock::now());
+    host.limit = limit;
+    host.tokens = std::min(host.tokens, limit.burst);
+    host.changed.notify_all();
+}
+
+std::map<std::string, HttpHostLimiterStats> RateLimitingHttpClient::getStats() {
+    std::map<std::string, HttpHostLimiterStats> stats;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Clock::time_point now = Clock::now();
+    for (auto& entry : m_hosts) {
+        Host& host = *entry.second;
+        refill(host, now);
+        HttpHostLimiterStats& s = stats[entry.first];
+        s.queueDepth = static_cast<size_t>(host.nextTicket - host.serving);
+        s.active = host.active;
+        s.tokens = host.tokens;
+        s.requests = host.requests;
+        s.throttled = host.throttled;
+        s.averageWaitMs = host.requests > 0 ? host.totalWaitMs / host.requests : 0.0;
+        s.maxWaitMs = host.maxWaitMs;
+        s.blockedFor = host.blockedUntil > now
+            ? std::chrono::duration_cast<std::chrono::milliseconds>(host.blockedUntil - now)
+            : std::chrono::milliseconds(0);
+    }
+    return stats;
+}
+
+RateLimitingHttpClient::Host& RateLimitingHttpClient::hostLocked(const std::string& key) {
+    std::unique_ptr<Host>& host = m_hosts[key];
+    if (!host) {
+        host.reset(new Host());
+        host->limit = m_defaultLimit;
+        host->tokens = m_defaultLimit.burst;
+        host->refilledAt = Clock::now();
+    }
+    return *host;
+}
+
+void RateLimitingHttpClient::refill(Host& host, Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - host.refilledAt).count();
+    host.tokens = std::min(host.limit.burst, host.tokens + elapsed * host.limit.requestsPerSecond);
+    host.refilledAt = now;
+}
+
+void RateLimitingHttpClient::acquire(const std::string& key) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Host& host = hostLocked(key);
+    const uint64_t ticket = host.nextTicket++;
+    const Clock::time_point queuedAt = Clock::now();
+
+    while (true) {
+        const Clock::time_point now = Clock::now();
+        const bool atCap = host.limit.maxConcurrent > 0 && host.active >= host.limit.maxConcurrent;
+        if (host.serving != ticket || atCap) {
+            // Woken by release() or by the caller ahead of us taking its turn
+            host.changed.wait(lock);
+            continue;
+        }
+        if (now < host.blockedUntil) {
+            host.changed.wait_until(lock, host.blockedUntil);
+            continue;
+        }
+        refill(host, now);
+        if (host.tokens < 1.0) {
+            if (host.limit.requestsPerSecond <= 0.0) {
+                host.changed.wait(lock);
+                continue;
+            }
+            auto untilToken = std::chrono::duration<double>((1.0 - host.tokens) / host.limit.requestsPerSecond);
+            host.changed.wait_until(lock, now + std::chrono::duration_cast<Clock::duration>(untilToken));
+            continue;
+        }
+        host.tokens -= 1.0;
+        break;
+    }
+
+    host.serving++;
+    host.active++;
+    host.requests++;
+    double waitedMs = std::chrono::duration<double, std::milli>(Clock::now() - queuedAt).count();
+    host.totalWaitMs += waitedMs;
+    host.maxWaitMs = std::max(host.maxWaitMs, waitedMs);
+    // The next ticket may be able to go right away
+    host.changed.notify_all();
+}
+
+void RateLimitingHttpClient::release(const std::string& key, const HttpResponse* response) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Host& host = hostLocked(key);
+    host.active--;
+    if (response && (response->status_code == 429 || response->status_code == 503)) {
+        host.throttled++;
+        // The server is already over its limit: stop spending the burst on it. Settle the
+        // refill first, or the time the request was in flight would be credited back later.
+        refill(host, Clock::now());
+        host.tokens = 0.0;
+        if (auto retryAfter = response->headers.find("retry-after")) {
+            std::optional<std::chrono::seconds> wait = parseRetryAfter(*retryAfter, host.limit.maxRetryAfter);
+            if (wait && wait->count() > 0) {
+                host.blockedUntil = std::max(host.blockedUntil, Clock::now() + *wait);
+            }
+        }
+    }
+    host.changed.notify_all();
+}
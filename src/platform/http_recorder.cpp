@@ -0,0 +1,241 @@
+#include "platform/http_recorder.hpp"
+#include "platform/http_coalescing.hpp"
+#include "platform/http_digest.hpp"
+#include "platform/logger.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static const char kMagic[] = "HTTPREC1";
+static constexpr size_t kMagicLength = sizeof(kMagic) - 1;
+// Replayed bodies reach sinks in pieces of this size
+static constexpr size_t kReplayChunk = 16 * 1024;
+
+static nlohmann::json timingToJson(const HttpTiming& timing) {
+    return nlohmann::json::array({
+        timing.name_lookup.count(), timing.connect.count(), timing.app_connect.count(),
+        timing.pre_transfer.count(), timing.start_transfer.count(), timing.total.count(),
+        timing.bytes_uploaded, timing.bytes_downloaded, timing.connection_reused});
+}
+
+static HttpTiming timingFromJson(const nlohmann::json& json) {
+    HttpTiming timing;
+    timing.name_lookup = std::chrono::microseconds(json.at(0).get<int64_t>());
+    timing.connect = std::chrono::microseconds(json.at(1).get<int64_t>());
+    timing.app_connect = std::chrono::microseconds(json.at(2).get<int64_t>());
+    timing.pre_transfer = std::chrono::microseconds(json.at(3).get<int64_t>());
+    timing.start_transfer = std::chrono::microseconds(json.at(4).get<int64_t>());
+    timing.total = std::chrono::microseconds(json.at(5).get<int64_t>());
+    timing.bytes_uploaded = json.at(6).get<size_t>();
+    timing.bytes_downloaded = json.at(7).get<size_t>();
+    timing.connection_reused = json.at(8).get<bool>();
+    return timing;
+}
+
+RecordingHttpClient::RecordingHttpClient(IHttpClient& inner, const std::string& path)
+    : m_inner(inner)
+    , m_file(path, std::ios::binary | std::ios::trunc)
+    , m_recorded(0)
+{
+    if (!m_file.write(kMagic, kMagicLength).flush()) {
+        throw std::runtime_error("Failed to create HTTP recording " + path);
+    }
+}
+
+HttpResponse RecordingHttpClient::get(const std::string& url,
+                                      const std::map<std::string, std::string>& params,
+                                      const std::map<std::string, std::string>& headers) {
+    HttpRequest request;
+    request.url = url;
+    request.params = params;
+    HttpResponse response;
+    try {
+        response = m_inner.get(url, params, headers);
+    } catch (const std::exception& e) {
+        record(request, response, e.what());
+        throw;
+    }
+    record(request, response, "");
+    return response;
+}
+
+HttpResponse RecordingHttpClient::request(const HttpRequest& request) {
+    HttpRequest forwarded = request;
+    std::string streamed;
+    if (request.sink) {
+        forwarded.sink = [&streamed, sink = request.sink](std::string_view chunk) {
+            streamed.append(chunk.data(), chunk.size());
+            return sink(chunk);
+        };
+    }
+    HttpResponse response;
+    try {
+        response = m_inner.request(forwarded);
+    } catch (const std::exception& e) {
+        record(request, response, e.what());
+        throw;
+    }
+    if (request.sink) {
+        HttpResponse captured = response;
+        captured.text = std::move(streamed);
+        record(request, captured, "");
+    } else {
+        record(request, response, "");
+    }
+    return response;
+}
+
+void RecordingHttpClient::record(const HttpRequest& request, const HttpResponse& response, const std::string& error) {
+    nlohmann::json record;
+    record["k"] = ReplayHttpClient::makeKey(request);
+    if (!error.empty()) {
+        record["e"] = error;
+    } else {
+        record["s"] = response.status_code;
+        record["h"] = response.headers.serialize();
+        record["b"] = nlohmann::json::binary(std::vector<uint8_t>(response.text.begin(), response.text.end()));
+        record["w"] = response.wire_bytes;
+        record["t"] = timingToJson(response.timing);
+    }
+    std::vector<uint8_t> packed;
+    try {
+        packed = nlohmann::json::to_msgpack(record);
+    } catch (const nlohmann::json::exception& e) {
+        // Header values that are not valid UTF-8
+        LOG_WARN("Not recording %s: %s", request.url.c_str(), e.what());
+        return;
+    }
+    const uint32_t length = static_cast<uint32_t>(packed.size());
+    const char prefix[4] = {static_cast<char>(length & 0xff), static_cast<char>((length >> 8) & 0xff),
+                            static_cast<char>((length >> 16) & 0xff), static_cast<char>((length >> 24) & 0xff)};
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.write(prefix, sizeof(prefix));
+    m_file.write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+    m_file.flush();
+    if (!m_file) {
+        LOG_ERROR("Failed to write HTTP recording for %s", request.url.c_str());
+        return;
+    }
+    m_recorded++;
+}
+
+ReplayHttpClient::ReplayHttpClient(const std::string& path, HttpReplayPacing pacing)
+    : m_pacing(pacing)
+    , m_count(0)
+    , m_replayed(0)
+    , m_misses(0)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("HTTP recording not found: " + path);
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.compare(0, kMagicLength, kMagic) != 0) {
+        throw std::runtime_error("Not an HTTP recording: " + path);
+    }
+
+    size_t offset = kMagicLength;
+    while (offset < data.size()) {
+        if (data.size() - offset < 4) {
+            throw std::runtime_error("Truncated HTTP recording: " + path);
+        }
+        const auto* prefix = reinterpret_cast<const unsigned char*>(data.data() + offset);
+        const size_t length = prefix[0] | (prefix[1] << 8) | (prefix[2] << 16) | (static_cast<size_t>(prefix[3]) << 24);
+        offset += 4;
+        if (data.size() - offset < length) {
+            throw std::runtime_error("Truncated HTTP recording: " + path);
+        }
+        try {
+            const auto* begin = reinterpret_cast<const uint8_t*>(data.data() + offset);
+            nlohmann::json record = nlohmann::json::from_msgpack(begin, begin + length);
+            Exchange exchange;
+            if (record.contains("e")) {
+                exchange.error = record["e"].get<std::string>();
+            } else {
+                HttpResponse& response = exchange.response;
+                response.status_code = record.at("s").get<int>();
+                response.headers = HttpHeaders::parse(record.at("h").get<std::string>());
+                const auto& body = record.at("b").get_binary();
+                response.text.assign(body.begin(), body.end());
+                response.decoded_bytes = response.text.size();
+                response.wire_bytes = record.at("w").get<size_t>();
+                response.timing = timingFromJson(record.at("t"));
+            }
+            m_entries[record.at("k").get<std::string>()].exchanges.push_back(std::move(exchange));
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error("Corrupt HTTP recording " + path + ": " + e.what());
+        }
+        offset += length;
+        m_count++;
+    }
+    LOG_INFO("Loaded %zu recorded HTTP exchanges from %s", m_count, path.c_str());
+}
+
+HttpResponse ReplayHttpClient::get(const std::string& url,
+                                   const std::map<std::string, std::string>& params,
+                                   const std::map<std::string, std::string>& headers) {
+    HttpRequest request;
+    request.url = url;
+    request.params = params;
+    request.headers = headers;
+    return this->request(request);
+}
+
+HttpResponse ReplayHttpClient::request(const HttpRequest& request) {
+    const std::string key = makeKey(request);
+    Exchange exchange;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            m_misses++;
+            throw std::runtime_error("No recorded response for " + request.method + " " + request.url);
+        }
+        Entry& entry = it->second;
+        exchange = entry.exchanges[std::min(entry.next, entry.exchanges.size() - 1)];
+        entry.next++;
+    }
+    m_replayed++;
+
+    if (m_pacing == HttpReplayPacing::Recorded && exchange.response.timing.total.count() > 0) {
+        std::this_thread::sleep_for(exchange.response.timing.total);
+    }
+    if (!exchange.error.empty()) {
+        throw std::runtime_error(exchange.error);
+    }
+    const bool accepted = exchange.response.text.empty() || !request.checkResponse
+        || request.checkResponse(exchange.response.status_code, exchange.response.headers);
+    if (!accepted) {
+        exchange.response.text.clear();
+    } else if (request.sink) {
+        std::string_view body = exchange.response.text;
+        for (size_t offset = 0; offset < body.size(); offset += kReplayChunk) {
+            if (!request.sink(body.substr(offset, kReplayChunk))) {
+                break;
+            }
+        }
+        exchange.response.text.clear();
+    }
+    return exchange.response;
+}
+
+std::string ReplayHttpClient::makeKey(const HttpRequest& request) {
+    std::string key = request.method + " " + CoalescingHttpClient::makeKey(request.url, request.params, {});
+    // Files by content, so an upload whose file changed between runs is a different request
+    if (!request.body.data.empty()) {
+        key += "\nbody:" + sha256Hex(request.body.data);
+    } else if (!request.body.filePath.empty()) {
+        key += "\nbody:" + sha256FileHex(request.body.filePath);
+    } else if (request.body.reader) {
+        key += "\nbody:reader";
+    }
+    for (const HttpFormPart& part : request.form) {
+        key += "\nform:" + part.name + ":"
+            + (part.filePath.empty() ? sha256Hex(part.data) : sha256FileHex(part.filePath));
+    }
+    return key;
+}
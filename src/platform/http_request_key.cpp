@@ -0,0 +1,85 @@
+#include "platform/http_request_key.hpp"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+
+static std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// Escapes '%', control characters (the '\n' between entries among them) and the
+// given separator, so the key can be split back into exactly its components
+static std::string escape(const std::string& s, char separator) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string escaped;
+    escaped.reserve(s.size());
+    for (char c : s) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '%' || c == separator || byte < 0x20 || byte == 0x7f) {
+            escaped += '%';
+            escaped += digits[byte >> 4];
+            escaped += digits[byte & 0x0f];
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static std::string normalizeUrl(const std::string& url) {
+    CURLU* parsed = curl_url();
+    if (!parsed) {
+        return url;
+    }
+    std::string normalized = url;
+    if (curl_url_set(parsed, CURLUPART_URL, url.c_str(), CURLU_GUESS_SCHEME) == CURLUE_OK) {
+        char* scheme = nullptr;
+        char* host = nullptr;
+        char* port = nullptr;
+        char* path = nullptr;
+        char* query = nullptr;
+        curl_url_get(parsed, CURLUPART_SCHEME, &scheme, 0);
+        curl_url_get(parsed, CURLUPART_HOST, &host, 0);
+        curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_NO_DEFAULT_PORT);
+        curl_url_get(parsed, CURLUPART_PATH, &path, 0);
+        curl_url_get(parsed, CURLUPART_QUERY, &query, 0);
+        if (scheme && host) {
+            normalized = toLower(scheme) + "://" + toLower(host);
+            if (port) {
+                normalized += std::string(":") + port;
+            }
+            normalized += path ? path : "/";
+            if (query) {
+                normalized += std::string("?") + query;
+            }
+        }
+        curl_free(scheme);
+        curl_free(host);
+        curl_free(port);
+        curl_free(path);
+        curl_free(query);
+    }
+    curl_url_cleanup(parsed);
+    return normalized;
+}
+
+std::string makeRequestKey(const std::string& url,
+                           const std::map<std::string, std::string>& params,
+                           const std::map<std::string, std::string>& headers) {
+    std::string key = escape(normalizeUrl(url), '\n');
+    // std::map keeps params ordered; header names are case-insensitive so they are re-sorted lower-cased
+    for (const auto& kv : params) {
+        key += '\n' + escape(kv.first, '=') + '=' + escape(kv.second, '\n');
+    }
+    std::map<std::string, std::string> normalizedHeaders;
+    for (const auto& kv : headers) {
+        normalizedHeaders[toLower(kv.first)] = kv.second;
+    }
+    key += '\n';
+    for (const auto& kv : normalizedHeaders) {
+        key += '\n' + escape(kv.first, ':') + ':' + escape(kv.second, '\n');
+    }
+    return key;
+}
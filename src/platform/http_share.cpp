@@ -0,0 +1,199 @@
+#include "platform/http_share.hpp"
+#include "platform/logger.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+#define HTTP_SHARE_HAS_SSLS_EXPORT 1
+#endif
+
+#ifdef HTTP_SHARE_HAS_SSLS_EXPORT
+static std::string toHex(const unsigned char* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(length * 2);
+    for (size_t i = 0; i < length; ++i) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 0x0f]);
+    }
+    return hex;
+}
+
+static bool fromHex(const std::string& hex, std::vector<unsigned char>& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out.clear();
+    out.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        unsigned int byte = 0;
+        if (std::sscanf(hex.c_str() + i, "%2x", &byte) != 1) {
+            return false;
+        }
+        out.push_back(static_cast<unsigned char>(byte));
+    }
+    return true;
+}
+
+static CURLcode exportSession(CURL*, void* userptr, const char*,
+                              const unsigned char* shmac, size_t shmacLength,
+                              const unsigned char* sdata, size_t sdataLength,
+                              curl_off_t validUntil, int, const char*, size_t) {
+    nlohmann::json& sessions = *static_cast<nlohmann::json*>(userptr);
+    if (validUntil > 0 && validUntil <= static_cast<curl_off_t>(std::time(nullptr))) {
+        return CURLE_OK;
+    }
+    // Only the salted hash of the peer key is stored, never the host name itself
+    sessions.push_back({
+        {"shmac", toHex(shmac, shmacLength)},
+        {"data", toHex(sdata, sdataLength)},
+        {"valid_until", static_cast<int64_t>(validUntil)}
+    });
+    return CURLE_OK;
+}
+#endif
+
+HttpShare::HttpShare(const std::string& sessionFile)
+    : m_share(curl_share_init())
+    , m_sessionFile(sessionFile)
+{
+    if (!m_share) {
+        throw std::runtime_error("Failed to initialize CURL share handle");
+    }
+    curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lockCallback);
+    curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlockCallback);
+    curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    if (!m_sessionFile.empty()) {
+        size_t loaded = loadTlsSessions();
+        if (loaded > 0) {
+            LOG_INFO("Restored %zu TLS sessions from %s", loaded, m_sessionFile.c_str());
+        }
+    }
+}
+
+HttpShare::~HttpShare() {
+    if (!m_sessionFile.empty()) {
+        saveTlsSessions();
+    }
+    if (curl_share_cleanup(m_share) != CURLSHE_OK) {
+        LOG_ERROR("CURL share handle still in use at shutdown");
+    }
+}
+
+void HttpShare::lockCallback(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<HttpShare*>(userptr)->m_locks[data].lock();
+}
+
+void HttpShare::unlockCallback(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<HttpShare*>(userptr)->m_locks[data].unlock();
+}
+
+size_t HttpShare::loadTlsSessions() {
+#ifdef HTTP_SHARE_HAS_SSLS_EXPORT
+    std::ifstream file(m_sessionFile);
+    if (!file.is_open()) {
+        return 0;
+    }
+    nlohmann::json sessions;
+    try {
+        file >> sessions;
+    } catch (const nlohmann::json::exception& e) {
+        LOG_ERROR("Error parsing TLS session file %s: %s", m_sessionFile.c_str(), e.what());
+        return 0;
+    }
+    if (!sessions.is_array()) {
+        return 0;
+    }
+
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        return 0;
+    }
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    size_t imported = 0;
+    std::vector<unsigned char> shmac;
+    std::vector<unsigned char> data;
+    for (const auto& session : sessions) {
+        int64_t validUntil = session.value("valid_until", static_cast<int64_t>(0));
+        if (validUntil > 0 && validUntil <= now) {
+            continue;
+        }
+        if (!fromHex(session.value("shmac", std::string()), shmac)
+            || !fromHex(session.value("data", std::string()), data)) {
+            continue;
+        }
+        CURLcode result = curl_easy_ssls_import(handle, nullptr, shmac.data(), shmac.size(),
+                                                data.data(), data.size());
+        if (result == CURLE_NOT_BUILT_IN) {
+            LOG_WARN("libcurl was built without TLS session export; sessions are not restored");
+            break;
+        }
+        if (result == CURLE_OK) {
+            imported++;
+        }
+    }
+    curl_easy_cleanup(handle);
+    return imported;
+#else
+    return 0;
+#endif
+}
+
+size_t HttpShare::saveTlsSessions() {
+#ifdef HTTP_SHARE_HAS_SSLS_EXPORT
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        return 0;
+    }
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+    nlohmann::json sessions = nlohmann::json::array();
+    CURLcode result = curl_easy_ssls_export(handle, exportSession, &sessions);
+    curl_easy_cleanup(handle);
+    if (result != CURLE_OK) {
+        if (result != CURLE_NOT_BUILT_IN) {
+            LOG_ERROR("Failed to export TLS sessions: %s", curl_easy_strerror(result));
+        }
+        return 0;
+    }
+
+    // Write to a temporary file first so a crash never leaves a truncated session file
+    const std::string tempPath = m_sessionFile + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR("Failed to open TLS session file %s for writing", tempPath.c_str());
+            return 0;
+        }
+        // Session tickets let whoever holds them resume the session: owner-only, before anything is written
+        std::error_code ec;
+        std::filesystem::permissions(tempPath, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                                     std::filesystem::perm_options::replace, ec);
+        if (ec) {
+            LOG_ERROR("Failed to restrict access to TLS session file %s: %s", tempPath.c_str(), ec.message().c_str());
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return 0;
+        }
+        file << sessions.dump();
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, m_sessionFile, ec);
+    if (ec) {
+        LOG_ERROR("Failed to replace TLS session file %s: %s", m_sessionFile.c_str(), ec.message().c_str());
+        return 0;
+    }
+    return sessions.size();
+#else
+    return 0;
+#endif
+}
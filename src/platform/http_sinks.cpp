@@ -0,0 +1,603 @@
+#include "platform/http_sinks.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+HttpFileSink::HttpFileSink(const std::string& path)
+    : m_file(std::fopen(path.c_str(), "wb"))
+    , m_bytesWritten(0)
+    , m_failed(false)
+{
+    if (!m_file) {
+        throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+}
+
+HttpFileSink::~HttpFileSink() {
+    close();
+}
+
+bool HttpFileSink::write(std::string_view chunk) {
+    if (!m_file || m_failed) {
+        return false;
+    }
+    if (std::fwrite(chunk.data(), 1, chunk.size(), m_file) != chunk.size()) {
+        m_failed = true;
+        return false;
+    }
+    m_bytesWritten += chunk.size();
+    return true;
+}
+
+bool HttpFileSink::close() {
+    if (m_file) {
+        if (std::fclose(m_file) != 0) {
+            m_failed = true;
+        }
+        m_file = nullptr;
+    }
+    return !m_failed;
+}
+
+HttpRingBufferSink::HttpRingBufferSink(size_t capacity)
+    : m_buffer(std::max<size_t>(capacity, 1))
+    , m_head(0)
+    , m_size(0)
+    , m_finished(false)
+    , m_cancelled(false)
+{
+}
+
+bool HttpRingBufferSink::write(std::string_view chunk) {
+    const size_t capacity = m_buffer.size();
+    while (!chunk.empty()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_canWrite.wait(lock, [this, capacity] { return m_size < capacity || m_cancelled; });
+        if (m_cancelled) {
+            return false;
+        }
+        size_t tail = (m_head + m_size) % capacity;
+        size_t count = std::min(chunk.size(), capacity - m_size);
+        size_t first = std::min(count, capacity - tail);
+        std::memcpy(m_buffer.data() + tail, chunk.data(), first);
+        std::memcpy(m_buffer.data(), chunk.data() + first, count - first);
+        m_size += count;
+        chunk.remove_prefix(count);
+        m_canRead.notify_one();
+    }
+    return true;
+}
+
+void HttpRingBufferSink::finish() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+    m_canRead.notify_all();
+}
+
+size_t HttpRingBufferSink::read(char* out, size_t maxBytes) {
+    const size_t capacity = m_buffer.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_canRead.wait(lock, [this] { return m_size > 0 || m_finished || m_cancelled; });
+    if (m_cancelled || m_size == 0) {
+        return 0;
+    }
+    size_t count = std::min(maxBytes, m_size);
+    size_t first = std::min(count, capacity - m_head);
+    std::memcpy(out, m_buffer.data() + m_head, first);
+    std::memcpy(out + first, m_buffer.data(), count - first);
+    m_head = (m_head + count) % capacity;
+    m_size -= count;
+    m_canWrite.notify_one();
+    return count;
+}
+
+void HttpRingBufferSink::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled = true;
+    m_canRead.notify_all();
+    m_canWrite.notify_all();
+}
+
+HttpJsonStreamSink::HttpJsonStreamSink(ValueHandler onValue, bool unwrapTopLevelArray)
+    : m_onValue(std::move(onValue))
+    , m_unwrapTopLevelArray(unwrapTopLevelArray)
+    , m_sawTopLevelValue(false)
+    , m_inTopLevelArray(false)
+    , m_depth(0)
+    , m_inString(false)
+    , m_escaped(false)
+    , m_valueCount(0)
+{
+}
+
+bool HttpJsonStreamSink::write(std::string_view chunk) {
+    if (!m_error.empty()) {
+        return false;
+    }
+    for (char c : chunk) {
+        if (m_inString) {
+            m_buffer += c;
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+                if (m_depth == (m_inTopLevelArray ? 1 : 0) && !emit()) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        const int base = m_inTopLevelArray ? 1 : 0;
+        if (m_depth == base) {
+            // Between values: whitespace and separators terminate a pending scalar
+            if (std::isspace(static_cast<unsigned char>(c)) || (m_inTopLevelArray && c == ',')) {
+                if (!m_buffer.empty() && !emit()) {
+                    return false;
+                }
+                continue;
+            }
+            if (m_inTopLevelArray && c == ']') {
+                if (!m_buffer.empty() && !emit()) {
+                    return false;
+                }
+                m_inTopLevelArray = false;
+                m_depth = 0;
+                continue;
+            }
+            if (c == '[' && m_unwrapTopLevelArray && !m_sawTopLevelValue && !m_inTopLevelArray && m_buffer.empty()) {
+                m_inTopLevelArray = true;
+                m_sawTopLevelValue = true;
+                m_depth = 1;
+                continue;
+            }
+        }
+
+        switch (c) {
+            case '"':
+                m_inString = true;
+                m_buffer += c;
+                break;
+            case '{':
+            case '[':
+                m_depth++;
+                m_buffer += c;
+                break;
+            case '}':
+            case ']':
+                if (m_depth == base) {
+                    return fail(std::string("Unexpected '") + c + "' in JSON stream");
+                }
+                m_depth--;
+                m_buffer += c;
+                if (m_depth == base && !emit()) {
+                    return false;
+                }
+                break;
+            default:
+                m_buffer += c;
+                break;
+        }
+    }
+    return true;
+}
+
+bool HttpJsonStreamSink::finish() {
+    if (!m_error.empty()) {
+        return false;
+    }
+    if (m_inString || m_inTopLevelArray || m_depth != 0) {
+        return fail("JSON stream ended in the middle of a value");
+    }
+    if (!m_buffer.empty()) {
+        return emit();
+    }
+    return true;
+}
+
+bool HttpJsonStreamSink::emit() {
+    nlohmann::json value = nlohmann::json::parse(m_buffer, nullptr, false);
+    if (value.is_discarded()) {
+        return fail("Invalid JSON value in stream");
+    }
+    // Keeps the buffer's capacity for the next value
+    m_buffer.clear();
+    m_sawTopLevelValue = true;
+    m_valueCount++;
+    return m_onValue(std::move(value));
+}
+
+bool HttpJsonStreamSink::fail(const std::string& error) {
+    m_error = error;
+    m_buffer.clear();
+    return false;
+}
+
+HttpJsonSaxSink::HttpJsonSaxSink(Sax& handler)
+    : m_handler(handler)
+    , m_expect(Expect::Value)
+    , m_token(Token::None)
+    , m_tokenIsKey(false)
+    , m_escape(0)
+    , m_unicode(0)
+    , m_highSurrogate(0)
+    , m_offset(0)
+    , m_valueCount(0)
+{
+}
+
+bool HttpJsonSaxSink::write(std::string_view chunk) {
+    if (!m_error.empty()) {
+        return false;
+    }
+    size_t i = 0;
+    while (i < chunk.size()) {
+        if (m_token == Token::String) {
+            if (!stringChars(chunk, i)) {
+                return false;
+            }
+            continue;
+        }
+        const char c = chunk[i];
+        if (m_token == Token::Number) {
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                m_text += c;
+                m_offset++;
+                i++;
+                continue;
+            }
+            if (!endToken()) {
+                return false;
+            }
+        } else if (m_token == Token::Literal) {
+            if (c >= 'a' && c <= 'z') {
+                m_text += c;
+                m_offset++;
+                i++;
+                continue;
+            }
+            if (!endToken()) {
+                return false;
+            }
+        }
+        m_offset++;
+        i++;
+        if (!structural(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpJsonSaxSink::finish() {
+    if (!m_error.empty()) {
+        return false;
+    }
+    if ((m_token == Token::Number || m_token == Token::Literal) && !endToken()) {
+        return false;
+    }
+    if (m_token != Token::None || !m_stack.empty() || m_expect != Expect::Value) {
+        return fail("JSON body ended in the middle of a value");
+    }
+    return true;
+}
+
+bool HttpJsonSaxSink::structural(char c) {
+    const bool wantValue = m_expect == Expect::Value || m_expect == Expect::ValueOrEnd;
+    switch (c) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            return true;
+        case '{':
+            if (!wantValue) {
+                break;
+            }
+            m_stack.push_back('{');
+            m_expect = Expect::KeyOrEnd;
+            return m_handler.start_object(static_cast<size_t>(-1)) || cancel();
+        case '[':
+            if (!wantValue) {
+                break;
+            }
+            m_stack.push_back('[');
+            m_expect = Expect::ValueOrEnd;
+            return m_handler.start_array(static_cast<size_t>(-1)) || cancel();
+        case '}':
+            if (m_stack.empty() || m_stack.back() != '{'
+                || (m_expect != Expect::KeyOrEnd && m_expect != Expect::CommaOrEnd)) {
+                break;
+            }
+            m_stack.pop_back();
+            if (!m_handler.end_object()) {
+                return cancel();
+            }
+            return endValue();
+        case ']':
+            if (m_stack.empty() || m_stack.back() != '['
+                || (m_expect != Expect::ValueOrEnd && m_expect != Expect::CommaOrEnd)) {
+                break;
+            }
+            m_stack.pop_back();
+            if (!m_handler.end_array()) {
+                return cancel();
+            }
+            return endValue();
+        case ',':
+            if (m_stack.empty() || m_expect != Expect::CommaOrEnd) {
+                break;
+            }
+            m_expect = m_stack.back() == '{' ? Expect::Key : Expect::Value;
+            return true;
+        case ':':
+            if (m_expect != Expect::Colon) {
+                break;
+            }
+            m_expect = Expect::Value;
+            return true;
+        case '"':
+            if (!wantValue && m_expect != Expect::KeyOrEnd && m_expect != Expect::Key) {
+                break;
+            }
+            m_token = Token::String;
+            m_tokenIsKey = !wantValue;
+            return true;
+        default:
+            if (!wantValue) {
+                break;
+            }
+            if ((c >= '0' && c <= '9') || c == '-') {
+                m_token = Token::Number;
+                m_text += c;
+                return true;
+            }
+            if (c == 't' || c == 'f' || c == 'n') {
+                m_token = Token::Literal;
+                m_text += c;
+                return true;
+            }
+            break;
+    }
+    return fail(std::string("Unexpected '") + c + "'");
+}
+
+bool HttpJsonSaxSink::stringChars(std::string_view chunk, size_t& i) {
+    while (i < chunk.size()) {
+        if (m_escape == 0) {
+            // Copy the run of plain characters in one go
+            size_t end = i;
+            while (end < chunk.size() && chunk[end] != '"' && chunk[end] != '\\'
+                   && static_cast<unsigned char>(chunk[end]) >= 0x20) {
+                end++;
+            }
+            if (end > i && m_highSurrogate != 0) {
+                return fail("Unpaired UTF-16 surrogate in string");
+            }
+            m_text.append(chunk.data() + i, end - i);
+            m_offset += end - i;
+            i = end;
+            if (i == chunk.size()) {
+                return true;
+            }
+        }
+
+        const char c = chunk[i++];
+        m_offset++;
+        if (m_escape == 0) {
+            if (c == '\\') {
+                m_escape = 1;
+                continue;
+            }
+            if (c != '"') {
+                return fail("Control character in string");
+            }
+            if (m_highSurrogate != 0) {
+                return fail("Unpaired UTF-16 surrogate in string");
+            }
+            return endToken();
+        }
+        if (m_escape == 1) {
+            if (c == 'u') {
+                m_escape = 2;
+                m_unicode = 0;
+                continue;
+            }
+            if (m_highSurrogate != 0) {
+                return fail("Unpaired UTF-16 surrogate in string");
+            }
+            m_escape = 0;
+            switch (c) {
+                case '"': m_text += '"'; break;
+                case '\\': m_text += '\\'; break;
+                case '/': m_text += '/'; break;
+                case 'b': m_text += '\b'; break;
+                case 'f': m_text += '\f'; break;
+                case 'n': m_text += '\n'; break;
+                case 'r': m_text += '\r'; break;
+                case 't': m_text += '\t'; break;
+                default: return fail(std::string("Invalid escape '\\") + c + "' in string");
+            }
+            continue;
+        }
+
+        // \uXXXX
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return fail("Invalid \\u escape in string");
+        }
+        m_unicode = (m_unicode << 4) | static_cast<uint32_t>(digit);
+        if (++m_escape < 6) {
+            continue;
+        }
+        m_escape = 0;
+        if (m_unicode >= 0xD800 && m_unicode <= 0xDBFF) {
+            if (m_highSurrogate != 0) {
+                return fail("Unpaired UTF-16 surrogate in string");
+            }
+            m_highSurrogate = m_unicode;
+            continue;
+        }
+        if (m_unicode >= 0xDC00 && m_unicode <= 0xDFFF) {
+            if (m_highSurrogate == 0) {
+                return fail("Unpaired UTF-16 surrogate in string");
+            }
+            uint32_t codePoint = 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_unicode - 0xDC00);
+            m_highSurrogate = 0;
+            appendCodePoint(codePoint);
+            continue;
+        }
+        if (m_highSurrogate != 0) {
+            return fail("Unpaired UTF-16 surrogate in string");
+        }
+        appendCodePoint(m_unicode);
+    }
+    return true;
+}
+
+void HttpJsonSaxSink::appendCodePoint(uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        m_text += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        m_text += static_cast<char>(0xC0 | (codePoint >> 6));
+        m_text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        m_text += static_cast<char>(0xE0 | (codePoint >> 12));
+        m_text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        m_text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        m_text += static_cast<char>(0xF0 | (codePoint >> 18));
+        m_text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        m_text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        m_text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+bool HttpJsonSaxSink::endToken() {
+    const Token token = m_token;
+    m_token = Token::None;
+    bool ok;
+    if (token == Token::String) {
+        if (m_tokenIsKey) {
+            ok = m_handler.key(m_text);
+            m_expect = Expect::Colon;
+        } else {
+            ok = m_handler.string(m_text) && endValue();
+        }
+        if (!ok && m_error.empty()) {
+            cancel();
+        }
+    } else if (token == Token::Number) {
+        ok = endNumber();
+    } else {
+        ok = endLiteral();
+    }
+    // Keeps the capacity for the next token
+    m_text.clear();
+    return ok;
+}
+
+bool HttpJsonSaxSink::endNumber() {
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    const std::string& text = m_text;
+    size_t i = 0;
+    auto digits = [&]() {
+        size_t start = i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            i++;
+        }
+        return i - start;
+    };
+    if (i < text.size() && text[i] == '-') {
+        i++;
+    }
+    size_t intStart = i;
+    size_t intDigits = digits();
+    bool valid = intDigits > 0 && !(intDigits > 1 && text[intStart] == '0');
+    bool isFloat = false;
+    if (valid && i < text.size() && text[i] == '.') {
+        i++;
+        isFloat = true;
+        valid = digits() > 0;
+    }
+    if (valid && i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        isFloat = true;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+            i++;
+        }
+        valid = digits() > 0;
+    }
+    if (!valid || i != text.size()) {
+        return fail("Invalid number '" + text + "'");
+    }
+
+    bool ok;
+    errno = 0;
+    if (!isFloat && text[0] == '-') {
+        long long value = std::strtoll(text.c_str(), nullptr, 10);
+        ok = errno == ERANGE ? m_handler.number_float(std::strtod(text.c_str(), nullptr), text)
+                             : m_handler.number_integer(value);
+    } else if (!isFloat) {
+        unsigned long long value = std::strtoull(text.c_str(), nullptr, 10);
+        ok = errno == ERANGE ? m_handler.number_float(std::strtod(text.c_str(), nullptr), text)
+                             : m_handler.number_unsigned(value);
+    } else {
+        ok = m_handler.number_float(std::strtod(text.c_str(), nullptr), text);
+    }
+    if (!ok) {
+        return cancel();
+    }
+    return endValue();
+}
+
+bool HttpJsonSaxSink::endLiteral() {
+    bool ok;
+    if (m_text == "true") {
+        ok = m_handler.boolean(true);
+    } else if (m_text == "false") {
+        ok = m_handler.boolean(false);
+    } else if (m_text == "null") {
+        ok = m_handler.null();
+    } else {
+        return fail("Invalid literal '" + m_text + "'");
+    }
+    if (!ok) {
+        return cancel();
+    }
+    return endValue();
+}
+
+bool HttpJsonSaxSink::endValue() {
+    if (m_stack.empty()) {
+        m_valueCount++;
+        m_expect = Expect::Value;
+    } else {
+        m_expect = Expect::CommaOrEnd;
+    }
+    return true;
+}
+
+bool HttpJsonSaxSink::fail(const std::string& error) {
+    m_handler.parse_error(m_offset, m_text, nlohmann::json::parse_error::create(101, m_offset, error, nullptr));
+    return cancel(error);
+}
+
+bool HttpJsonSaxSink::cancel(const std::string& error) {
+    m_error = error;
+    m_text.clear();
+    m_stack.clear();
+    m_token = Token::None;
+    return false;
+}
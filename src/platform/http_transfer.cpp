@@ -0,0 +1,345 @@
+#include "platform/http_transfer.hpp"
+#include "platform/http_ca_store.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
+
+HttpTransfer::HttpTransfer(HttpConnectionPool& pool, const HttpRequest& request)
+    : m_pool(pool)
+    , m_poolKey(HttpConnectionPool::makeKey(request.url))
+    , m_handle(nullptr)
+    , m_headers(nullptr)
+    , m_sink(request.sink)
+    , m_checkResponse(request.checkResponse)
+    , m_sinkCancelled(false)
+    , m_cancelToken(request.cancelToken)
+    , m_bodyBytes(0)
+    , m_response()
+    , m_uploadFile(nullptr)
+    , m_mime(nullptr)
+{
+    m_handle = m_pool.acquire(m_poolKey);
+    m_url = buildUrl(m_handle, request.url, request.params);
+
+    curl_easy_setopt(m_handle, CURLOPT_URL, m_url.c_str());
+    curl_easy_setopt(m_handle, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(m_handle, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(m_handle, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(m_handle, CURLOPT_HEADERDATA, this);
+    curl_easy_setopt(m_handle, CURLOPT_FOLLOWLOCATION, 1L);
+    setTimeout(HttpRetryPolicy().attemptTimeout);
+    curl_easy_setopt(m_handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(m_handle, CURLOPT_NOSIGNAL, 1L);
+    if (m_cancelToken) {
+        // Called at least once a second, and far more often while data is moving
+        curl_easy_setopt(m_handle, CURLOPT_XFERINFOFUNCTION, progressCallback);
+        curl_easy_setopt(m_handle, CURLOPT_XFERINFODATA, this);
+        curl_easy_setopt(m_handle, CURLOPT_NOPROGRESS, 0L);
+    }
+    if (request.acceptCompressed) {
+        // Empty string: offer all encodings built into curl (gzip/deflate, brotli, zstd)
+        curl_easy_setopt(m_handle, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
+    for (const auto& kv : request.headers) {
+        std::string header_line = kv.first + ": " + kv.second;
+        m_headers = curl_slist_append(m_headers, header_line.c_str());
+    }
+    if (m_headers) {
+        curl_easy_setopt(m_handle, CURLOPT_HTTPHEADER, m_headers);
+    }
+
+    HttpCaStore::getInstance().apply(m_handle);
+
+    try {
+        setMethodAndBody(request);
+    } catch (...) {
+        // The destructor won't run for a half-constructed transfer
+        curl_easy_cleanup(m_handle);
+        curl_slist_free_all(m_headers);
+        curl_mime_free(m_mime);
+        if (m_uploadFile) {
+            std::fclose(m_uploadFile);
+        }
+        throw;
+    }
+}
+
+HttpTransfer::~HttpTransfer() {
+    if (m_handle) {
+        // Never completed (e.g. aborted engine shutdown): the connection state is unknown
+        curl_easy_cleanup(m_handle);
+    }
+    if (m_headers) {
+        curl_slist_free_all(m_headers);
+    }
+    curl_mime_free(m_mime);
+    if (m_uploadFile) {
+        std::fclose(m_uploadFile);
+    }
+}
+
+void HttpTransfer::setMethodAndBody(const HttpRequest& request) {
+    const std::string& method = request.method;
+    if (method == "HEAD") {
+        curl_easy_setopt(m_handle, CURLOPT_NOBODY, 1L);
+    } else if (method != "GET" && method != "POST") {
+        curl_easy_setopt(m_handle, CURLOPT_CUSTOMREQUEST, method.c_str());
+    }
+
+    if (!request.form.empty()) {
+        setForm(request.form);
+        return;
+    }
+
+    const HttpRequestBody& body = request.body;
+    if (!body.filePath.empty()) {
+        m_uploadFile = std::fopen(body.filePath.c_str(), "rb");
+        if (!m_uploadFile) {
+            throw std::runtime_error("Failed to open upload file: " + body.filePath);
+        }
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(body.filePath, ec);
+        curl_easy_setopt(m_handle, CURLOPT_POST, 1L);
+        curl_easy_setopt(m_handle, CURLOPT_POSTFIELDSIZE_LARGE, ec ? curl_off_t(-1) : static_cast<curl_off_t>(size));
+        curl_easy_setopt(m_handle, CURLOPT_READFUNCTION, readCallback);
+        curl_easy_setopt(m_handle, CURLOPT_READDATA, this);
+        // Lets curl rewind the file when it has to resend the body (redirects, auth)
+        curl_easy_setopt(m_handle, CURLOPT_SEEKFUNCTION, seekCallback);
+        curl_easy_setopt(m_handle, CURLOPT_SEEKDATA, this);
+    } else if (body.reader) {
+        m_reader = body.reader;
+        curl_easy_setopt(m_handle, CURLOPT_POST, 1L);
+        curl_easy_setopt(m_handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body.length));
+        curl_easy_setopt(m_handle, CURLOPT_READFUNCTION, readCallback);
+        curl_easy_setopt(m_handle, CURLOPT_READDATA, this);
+    } else if (!body.data.empty() || method == "POST" || method == "PUT" || method == "PATCH") {
+        // POSTFIELDS points curl at the caller's memory; COPYPOSTFIELDS would copy it
+        curl_easy_setopt(m_handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body.data.size()));
+        curl_easy_setopt(m_handle, CURLOPT_POSTFIELDS, body.data.empty() ? "" : body.data.data());
+    }
+}
+
+void HttpTransfer::setForm(const std::vector<HttpFormPart>& form) {
+    m_mime = curl_mime_init(m_handle);
+    for (const HttpFormPart& part : form) {
+        curl_mimepart* mimePart = curl_mime_addpart(m_mime);
+        curl_mime_name(mimePart, part.name.c_str());
+        if (!part.filePath.empty()) {
+            // curl streams the file itself and defaults the part's file name to its base name
+            if (curl_mime_filedata(mimePart, part.filePath.c_str()) != CURLE_OK) {
+                throw std::runtime_error("Failed to open upload file: " + part.filePath);
+            }
+        } else {
+            m_formViews.push_back(BodyView{part.data, 0});
+            curl_mime_data_cb(mimePart, static_cast<curl_off_t>(part.data.size()),
+                              viewReadCallback, viewSeekCallback, nullptr, &m_formViews.back());
+        }
+        if (!part.fileName.empty()) {
+            curl_mime_filename(mimePart, part.fileName.c_str());
+        }
+        if (!part.contentType.empty()) {
+            curl_mime_type(mimePart, part.contentType.c_str());
+        }
+    }
+    curl_easy_setopt(m_handle, CURLOPT_MIMEPOST, m_mime);
+}
+
+void HttpTransfer::setTimeout(std::chrono::milliseconds timeout) {
+    curl_easy_setopt(m_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+}
+
+CURLcode HttpTransfer::perform() {
+    return curl_easy_perform(m_handle);
+}
+
+void HttpTransfer::complete(CURLcode result) {
+    long http_code = 0;
+    curl_easy_getinfo(m_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    m_response.status_code = static_cast<int>(http_code);
+    curl_off_t wireBytes = 0;
+    curl_easy_getinfo(m_handle, CURLINFO_SIZE_DOWNLOAD_T, &wireBytes);
+    m_response.wire_bytes = static_cast<size_t>(wireBytes);
+    m_response.decoded_bytes = m_bodyBytes;
+    readTiming();
+
+    if (result == CURLE_OK) {
+        m_pool.release(m_poolKey, m_handle);
+    } else {
+        // Don't hand a handle with a broken transfer back to the pool
+        curl_easy_cleanup(m_handle);
+    }
+    m_handle = nullptr;
+}
+
+void HttpTransfer::readTiming() {
+    HttpTiming& timing = m_response.timing;
+    auto phase = [this](CURLINFO info) {
+        curl_off_t micros = 0;
+        curl_easy_getinfo(m_handle, info, &micros);
+        return std::chrono::microseconds(micros);
+    };
+    timing.name_lookup = phase(CURLINFO_NAMELOOKUP_TIME_T);
+    timing.connect = phase(CURLINFO_CONNECT_TIME_T);
+    timing.app_connect = phase(CURLINFO_APPCONNECT_TIME_T);
+    timing.pre_transfer = phase(CURLINFO_PRETRANSFER_TIME_T);
+    timing.start_transfer = phase(CURLINFO_STARTTRANSFER_TIME_T);
+    timing.total = phase(CURLINFO_TOTAL_TIME_T);
+
+    curl_off_t uploaded = 0;
+    curl_easy_getinfo(m_handle, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+    timing.bytes_uploaded = static_cast<size_t>(uploaded);
+    timing.bytes_downloaded = m_response.wire_bytes;
+    long newConnections = 0;
+    curl_easy_getinfo(m_handle, CURLINFO_NUM_CONNECTS, &newConnections);
+    timing.connection_reused = newConnections == 0;
+}
+
+std::string HttpTransfer::buildUrl(CURL* handle, const std::string& url,
+                                   const std::map<std::string, std::string>& params) {
+    if (params.empty()) {
+        return url;
+    }
+    std::ostringstream oss;
+    oss << url << "?";
+    bool first = true;
+    for (const auto& kv : params) {
+        if (!first) oss << "&";
+        first = false;
+        char* key_escaped = curl_easy_escape(handle, kv.first.c_str(), 0);
+        char* val_escaped = curl_easy_escape(handle, kv.second.c_str(), 0);
+        oss << key_escaped << "=" << val_escaped;
+        curl_free(key_escaped);
+        curl_free(val_escaped);
+    }
+    return oss.str();
+}
+
+std::string HttpTransfer::describeError(CURLcode result) {
+    return std::string("curl_easy_perform() failed: ") + curl_easy_strerror(result);
+}
+
+std::string HttpTransfer::describeFailure(CURLcode result) const {
+    if (cancelled()) {
+        return "Request cancelled";
+    }
+    if (!m_sinkError.empty()) {
+        return "Response sink failed: " + m_sinkError;
+    }
+    if (!m_readerError.empty()) {
+        return "Request body reader failed: " + m_readerError;
+    }
+    return describeError(result);
+}
+
+size_t HttpTransfer::writeCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    HttpTransfer* transfer = static_cast<HttpTransfer*>(userp);
+    size_t total_size = size * nmemb;
+    if (transfer->m_bodyBytes == 0 && transfer->m_checkResponse) {
+        // Headers of followed redirects were already replaced, so these are the final ones
+        long status = 0;
+        curl_easy_getinfo(transfer->m_handle, CURLINFO_RESPONSE_CODE, &status);
+        bool accepted = false;
+        try {
+            accepted = transfer->m_checkResponse(static_cast<int>(status), transfer->m_response.headers);
+        } catch (const std::exception& e) {
+            transfer->m_sinkError = e.what();
+        }
+        if (!accepted) {
+            transfer->m_sinkCancelled = transfer->m_sinkError.empty();
+            return CURL_WRITEFUNC_ERROR;
+        }
+    }
+    transfer->m_bodyBytes += total_size;
+    if (!transfer->m_sink) {
+        transfer->m_response.text.append(static_cast<char*>(contents), total_size);
+        return total_size;
+    }
+
+    bool keepGoing = false;
+    try {
+        keepGoing = transfer->m_sink(std::string_view(static_cast<char*>(contents), total_size));
+    } catch (const std::exception& e) {
+        // Exceptions must not unwind through libcurl
+        transfer->m_sinkError = e.what();
+    }
+    if (!keepGoing) {
+        transfer->m_sinkCancelled = transfer->m_sinkError.empty();
+        return CURL_WRITEFUNC_ERROR;
+    }
+    return total_size;
+}
+
+int HttpTransfer::progressCallback(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    // Non-zero aborts the transfer with CURLE_ABORTED_BY_CALLBACK
+    return static_cast<HttpTransfer*>(userp)->cancelled() ? 1 : 0;
+}
+
+size_t HttpTransfer::headerCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    HttpTransfer* transfer = static_cast<HttpTransfer*>(userp);
+    size_t total_size = size * nitems;
+    transfer->m_response.headers.addLine(std::string_view(buffer, total_size));
+    return total_size;
+}
+
+size_t HttpTransfer::readCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    HttpTransfer* transfer = static_cast<HttpTransfer*>(userp);
+    size_t capacity = size * nitems;
+    if (transfer->m_uploadFile) {
+        size_t read = std::fread(buffer, 1, capacity, transfer->m_uploadFile);
+        if (read == 0 && std::ferror(transfer->m_uploadFile)) {
+            return CURL_READFUNC_ABORT;
+        }
+        return read;
+    }
+    try {
+        return std::min(transfer->m_reader(buffer, capacity), capacity);
+    } catch (const std::exception& e) {
+        // Exceptions must not unwind through libcurl
+        transfer->m_readerError = e.what();
+        return CURL_READFUNC_ABORT;
+    }
+}
+
+int HttpTransfer::seekCallback(void* userp, curl_off_t offset, int origin) {
+    HttpTransfer* transfer = static_cast<HttpTransfer*>(userp);
+    if (!transfer->m_uploadFile || origin != SEEK_SET) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    // long is 32 bits on Windows, so fseek can't reach past 2 GiB there
+#if defined(_WIN32)
+    const int failed = _fseeki64(transfer->m_uploadFile, offset, SEEK_SET);
+#else
+    if (offset < 0 || static_cast<uintmax_t>(offset) > static_cast<uintmax_t>(std::numeric_limits<off_t>::max())) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    const int failed = fseeko(transfer->m_uploadFile, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    return failed == 0 ? CURL_SEEKFUNC_OK : CURL_SEEKFUNC_FAIL;
+}
+
+size_t HttpTransfer::viewReadCallback(char* buffer, size_t size, size_t nitems, void* arg) {
+    BodyView* view = static_cast<BodyView*>(arg);
+    size_t count = std::min(size * nitems, view->data.size() - view->offset);
+    if (count > 0) {
+        std::memcpy(buffer, view->data.data() + view->offset, count);
+        view->offset += count;
+    }
+    return count;
+}
+
+int HttpTransfer::viewSeekCallback(void* arg, curl_off_t offset, int origin) {
+    BodyView* view = static_cast<BodyView*>(arg);
+    if (origin != SEEK_SET || offset < 0 || static_cast<size_t>(offset) > view->data.size()) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    view->offset = static_cast<size_t>(offset);
+    return CURL_SEEKFUNC_OK;
+}
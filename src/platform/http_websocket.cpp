@@ -0,0 +1,347 @@
+#include "platform/http_websocket.hpp"
+#include "platform/http_ca_store.hpp"
+#include "platform/logger.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Room made available to curl_ws_recv per call
+static constexpr size_t kReceiveChunk = 16 * 1024;
+// Longest wait on the socket, so close() and keepalive checks are noticed promptly
+static constexpr int kMaxPollMs = 100;
+
+static bool waitSocket(curl_socket_t socket, bool forWrite, int timeoutMs) {
+#if defined(_WIN32)
+    WSAPOLLFD fd = {};
+    fd.fd = socket;
+    fd.events = forWrite ? POLLWRNORM : POLLRDNORM;
+    return WSAPoll(&fd, 1, timeoutMs) > 0;
+#else
+    pollfd fd = {};
+    fd.fd = socket;
+    fd.events = forWrite ? POLLOUT : POLLIN;
+    return ::poll(&fd, 1, timeoutMs) > 0;
+#endif
+}
+
+static int abortWhenClosed(void* userptr, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<std::atomic<bool>*>(userptr)->load() ? 1 : 0;
+}
+
+void HttpWebSocketBatch::moveCompleteTo(HttpWebSocketBatch& out) {
+    out.m_messages.clear();
+    m_buffer.swap(out.m_buffer);
+    m_messages.swap(out.m_messages);
+    out.m_used = m_committed;
+    out.m_committed = m_committed;
+
+    const size_t partial = m_used - m_committed;
+    if (m_buffer.size() < partial + kReceiveChunk) {
+        m_buffer.resize(partial + kReceiveChunk);
+    }
+    if (partial > 0) {
+        std::memcpy(&m_buffer[0], out.m_buffer.data() + m_committed, partial);
+    }
+    m_used = partial;
+    m_committed = 0;
+}
+
+HttpWebSocket::HttpWebSocket(HttpClient& client,
+                             const std::string& url,
+                             MessagesHandler onMessages,
+                             const HttpWebSocketOptions& options,
+                             ErrorHandler onError)
+    : m_client(client)
+    , m_url(url)
+    , m_options(options)
+    , m_delivery(std::make_shared<Delivery>())
+    , m_handle(nullptr)
+    , m_closed(false)
+    , m_connected(false)
+    , m_messageCount(0)
+    , m_reconnects(0)
+{
+    m_delivery->onMessages = std::move(onMessages);
+    m_delivery->onError = std::move(onError);
+    m_thread = std::thread(&HttpWebSocket::run, this);
+}
+
+HttpWebSocket::~HttpWebSocket() {
+    close();
+}
+
+bool HttpWebSocket::send(std::string_view text) {
+    return sendFrame(text, CURLWS_TEXT);
+}
+
+bool HttpWebSocket::sendBinary(std::string_view data) {
+    return sendFrame(data, CURLWS_BINARY);
+}
+
+void HttpWebSocket::close() {
+    if (!m_closed.exchange(true)) {
+        static const char normalClosure[] = {'\x03', '\xE8'}; // Status code 1000
+        sendFrame(std::string_view(normalClosure, sizeof(normalClosure)), CURLWS_CLOSE);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_delivery->mutex);
+        m_delivery->closed = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex); // Orders the flag with a run() about to wait
+    }
+    m_wake.notify_all();
+    // Without a dispatcher the handlers run on the connection thread, which exits on
+    // its own after this; the destructor joins it
+    if (m_thread.get_id() == std::this_thread::get_id()) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool HttpWebSocket::sendFrame(std::string_view data, unsigned int flags) {
+    std::lock_guard<std::mutex> lock(m_handleMutex);
+    if (!m_handle) {
+        return false;
+    }
+    curl_socket_t socket = CURL_SOCKET_BAD;
+    curl_easy_getinfo(m_handle, CURLINFO_ACTIVESOCKET, &socket);
+    const auto deadline = Clock::now() + m_options.sendTimeout;
+    size_t offset = 0;
+    do {
+        size_t sent = 0;
+        CURLcode result = curl_ws_send(m_handle, data.data() + offset, data.size() - offset, &sent, 0, flags);
+        offset += sent;
+        if (result == CURLE_AGAIN) {
+            // curl keeps what it already framed; the next call must pass the same remaining data
+            if (Clock::now() >= deadline) {
+                LOG_WARN("WebSocket send to %s timed out", m_url.c_str());
+                return false;
+            }
+            waitSocket(socket, true, kMaxPollMs);
+        } else if (result != CURLE_OK) {
+            LOG_WARN("WebSocket send to %s failed: %s", m_url.c_str(), curl_easy_strerror(result));
+            return false;
+        }
+    } while (offset < data.size());
+    return true;
+}
+
+void HttpWebSocket::run() {
+    std::chrono::milliseconds failureDelay = m_options.reconnectDelay;
+    bool firstConnection = true;
+    while (!m_closed) {
+        if (!firstConnection) {
+            m_reconnects++;
+        }
+        firstConnection = false;
+
+        std::string error;
+        const uint64_t messagesBefore = m_messageCount.load();
+        CURL* handle = connect(error);
+        if (handle) {
+            {
+                std::lock_guard<std::mutex> lock(m_handleMutex);
+                m_handle = handle;
+            }
+            m_connected = true;
+            m_lastActivity = Clock::now();
+            auto lastPing = m_lastActivity;
+            curl_socket_t socket = CURL_SOCKET_BAD;
+            curl_easy_getinfo(handle, CURLINFO_ACTIVESOCKET, &socket);
+
+            while (!m_closed && receive(handle, error)) {
+                const auto now = Clock::now();
+                if (m_options.pingInterval.count() > 0) {
+                    if (now - m_lastActivity > m_options.pingInterval + m_options.pongTimeout) {
+                        error = "No data or pong for " + std::to_string(
+                            (m_options.pingInterval + m_options.pongTimeout).count()) + " ms";
+                        break;
+                    }
+                    if (now - m_lastActivity >= m_options.pingInterval && now - lastPing >= m_options.pingInterval) {
+                        sendFrame({}, CURLWS_PING);
+                        lastPing = now;
+                    }
+                }
+                waitSocket(socket, false, kMaxPollMs);
+            }
+
+            m_connected = false;
+            {
+                std::lock_guard<std::mutex> lock(m_handleMutex);
+                m_handle = nullptr;
+            }
+            curl_easy_cleanup(handle);
+        }
+        if (m_closed) {
+            break;
+        }
+
+        // A connection that delivered messages was healthy: start the backoff over
+        if (m_messageCount.load() > messagesBefore) {
+            failureDelay = m_options.reconnectDelay;
+        }
+        const std::chrono::milliseconds delay = failureDelay;
+        failureDelay = std::min(failureDelay * 2, m_options.maxReconnectDelay);
+        LOG_WARN("WebSocket %s: %s; reconnecting in %lld ms", m_url.c_str(), error.c_str(),
+                 static_cast<long long>(delay.count()));
+        reportError(error);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait_for(lock, delay, [this] { return m_closed.load(); });
+    }
+}
+
+CURL* HttpWebSocket::connect(std::string& error) {
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        error = "Failed to initialize CURL";
+        return nullptr;
+    }
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_client.getShareHandle());
+    curl_easy_setopt(handle, CURLOPT_URL, m_url.c_str());
+    curl_easy_setopt(handle, CURLOPT_CONNECT_ONLY, 2L); // 2: finish the upgrade handshake, then hand over
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(m_options.connectTimeout.count()));
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, abortWhenClosed);
+    curl_easy_setopt(handle, CURLOPT_XFERINFODATA, &m_closed);
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+    HttpCaStore::getInstance().apply(handle);
+
+    curl_slist* headers = nullptr;
+    for (const auto& kv : m_options.headers) {
+        headers = curl_slist_append(headers, (kv.first + ": " + kv.second).c_str());
+    }
+    if (!m_options.protocol.empty()) {
+        headers = curl_slist_append(headers, ("Sec-WebSocket-Protocol: " + m_options.protocol).c_str());
+    }
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+
+    CURLcode result = curl_easy_perform(handle);
+    curl_slist_free_all(headers);
+    if (result != CURLE_OK) {
+        error = curl_easy_strerror(result);
+        curl_easy_cleanup(handle);
+        return nullptr;
+    }
+    return handle;
+}
+
+bool HttpWebSocket::receive(CURL* handle, std::string& error) {
+    bool received = false;
+    bool open = true;
+    bool closedByServer = false;
+    while (true) {
+        std::unique_lock<std::mutex> deliveryLock(m_delivery->mutex);
+        HttpWebSocketBatch& batch = m_delivery->incoming;
+        if (batch.m_buffer.size() < batch.m_used + kReceiveChunk) {
+            batch.m_buffer.resize(std::max(batch.m_buffer.size() * 2, batch.m_used + kReceiveChunk));
+        }
+        size_t length = 0;
+        const curl_ws_frame* frame = nullptr;
+        CURLcode result;
+        {
+            std::lock_guard<std::mutex> lock(m_handleMutex);
+            result = curl_ws_recv(handle, &batch.m_buffer[batch.m_used], batch.m_buffer.size() - batch.m_used,
+                                  &length, &frame);
+        }
+        if (result == CURLE_AGAIN) {
+            break;
+        }
+        if (result != CURLE_OK) {
+            error = result == CURLE_GOT_NOTHING ? "Connection closed" : curl_easy_strerror(result);
+            open = false;
+        } else if (frame->flags & CURLWS_CLOSE) {
+            error = "Closed by the server";
+            open = false;
+            closedByServer = true;
+        } else if (frame->flags & (CURLWS_PING | CURLWS_PONG)) {
+            m_lastActivity = Clock::now();
+            continue; // Pings are answered by curl; either way the connection is alive
+        } else {
+            m_lastActivity = Clock::now();
+            if (batch.m_used == batch.m_committed) {
+                batch.m_partialBinary = (frame->flags & CURLWS_BINARY) != 0;
+            }
+            batch.m_used += length;
+            if (batch.m_used - batch.m_committed > m_options.maxMessageSize) {
+                error = "Message larger than " + std::to_string(m_options.maxMessageSize) + " bytes";
+                open = false;
+            } else if (frame->bytesleft == 0 && !(frame->flags & CURLWS_CONT)) {
+                // CURLWS_CONT is set on every fragment but the last one of a message
+                batch.m_messages.push_back({batch.m_committed, batch.m_used - batch.m_committed, batch.m_partialBinary});
+                batch.m_committed = batch.m_used;
+                m_messageCount++;
+                received = true;
+            }
+        }
+        if (!open) {
+            // A message cut short must not be prepended to the first one of the next connection
+            batch.m_used = batch.m_committed;
+            break;
+        }
+    }
+    if (closedByServer) {
+        sendFrame({}, CURLWS_CLOSE);
+    }
+    // Messages that came just before the connection ended are delivered right away too
+    if (received) {
+        schedule();
+    }
+    return open;
+}
+
+void HttpWebSocket::schedule() {
+    {
+        std::lock_guard<std::mutex> lock(m_delivery->mutex);
+        if (m_delivery->scheduled || m_delivery->closed) {
+            return;
+        }
+        m_delivery->scheduled = true;
+    }
+    std::shared_ptr<Delivery> delivery = m_delivery;
+    m_client.dispatchToMainThread([delivery]() {
+        HttpWebSocketBatch batch;
+        {
+            std::lock_guard<std::mutex> lock(delivery->mutex);
+            delivery->scheduled = false;
+            if (delivery->closed) {
+                return;
+            }
+            batch = std::move(delivery->spare);
+            delivery->incoming.moveCompleteTo(batch);
+        }
+        if (!batch.empty() && delivery->onMessages) {
+            delivery->onMessages(batch);
+        }
+        std::lock_guard<std::mutex> lock(delivery->mutex);
+        delivery->spare = std::move(batch);
+    });
+}
+
+void HttpWebSocket::reportError(const std::string& error) {
+    std::shared_ptr<Delivery> delivery = m_delivery;
+    if (!delivery->onError) {
+        return;
+    }
+    m_client.dispatchToMainThread([delivery, error]() {
+        {
+            std::lock_guard<std::mutex> lock(delivery->mutex);
+            if (delivery->closed) {
+                return;
+            }
+        }
+        delivery->onError(error);
+    });
+}
@@ -10,6 +10,8 @@
 #include <filesystem> // For std::filesystem
 #include "../../include/platform/state_manager.h" // For StateManager
 #include "../../include/platform/font_manager.h" // For FontManager
+#include "../../include/platform/settings_manager.h" // For the preconnect host list
+#include "../../include/platform/worker.hpp" // For Worker
 
 // Helper function to convert package name to camel case
 std::string toCamelCase(const std::string& s) {
@@ -129,6 +131,13 @@ int main(int argc, char** argv)
         #if defined(LINUX)
         PlatformType app("ImGui Hello World", 720, 1280); // Default width and height
         StateManager::getInstance().loadStateAsync();
+        // Warm up DNS, TCP and TLS for the API hosts while the window comes up. Posted
+        // behind the load on the state queue, so the host list is read once it is in.
+        Worker::getInstance().postOn(StateManager::getInstance().getQueue(), []() {
+            if (Application* instance = Application::getInstance()) {
+                instance->preconnect(SettingsManager::getInstance().getPreconnectHosts());
+            }
+        });
 #elif (defined(__ANDROID__))
         PlatformType app("ImGui Hello World", nullptr); // Pass nullptr for Android
 #else
@@ -279,6 +279,27 @@ void SettingsManager::updateAvailableFonts()
     m_availableFontSizes = ::Platform_GetAvailableFontSizes();
 }
 
+std::vector<std::string> SettingsManager::getPreconnectHosts() const
+{
+    std::string value;
+    if (!StateManager::getInstance().loadString("settings_preconnect_hosts", value)) {
+        return {};
+    }
+    std::vector<std::string> hosts;
+    size_t start = 0;
+    while (start < value.size()) {
+        size_t end = value.find_first_of(", \t\n", start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        if (end > start) {
+            hosts.push_back(value.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return hosts;
+}
+
 void SettingsManager::loadSettings()
 {
     Settings loadedSettings;
@@ -309,7 +330,8 @@ void SettingsManager::saveSettingsInternal(const Settings& settings)
 
 void SettingsManager::saveSettingsAsync()
 {
-    Worker::getInstance().postTask([this]() {
+    // On the state queue, so the settings land on top of the loaded state
+    Worker::getInstance().postOn(StateManager::getInstance().getQueue(), [this]() {
         saveSettingsInternal(m_currentSettings);
     });
 }
@@ -110,7 +110,7 @@ void StateManager::saveStateInternal() {
 
 void StateManager::loadStateAsync() {
     LOG_INFO("StateManager::loadStateAsync() called.");
-    Worker::getInstance().postTask([this]() {
+    Worker::getInstance().postOn(m_queue, [this]() {
         loadStateInternal();
         m_stateLoaded.store(true);
     });
@@ -120,7 +120,7 @@ void StateManager::loadStateAsync() {
 
 void StateManager::saveStateAsync() {
     LOG_INFO("StateManager::saveStateAsync() called.");
-    Worker::getInstance().postTask([this]() {
+    Worker::getInstance().postOn(m_queue, [this]() {
         saveStateInternal();
     });
 }
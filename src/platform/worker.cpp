@@ -1,13 +1,38 @@
 #include "../include/platform/worker.hpp"
+#include "../include/platform/logger.h"
+#include <algorithm>
+#include <exception>
 #include <future> // Required for std::packaged_task
+#include <stdexcept>
+
+// The pool and queue the current thread belongs to, so tasks posted from inside a
+// task stay on the posting thread's queue
+static thread_local Worker* t_worker = nullptr;
+static thread_local size_t t_index = 0;
+
+Worker::Queue::Queue() : m_state(std::make_shared<State>()) {}
 
 Worker& Worker::getInstance() {
     static Worker instance;
     return instance;
 }
 
-Worker::Worker() : m_running(true) {
-    m_workerThread = std::thread(&Worker::threadLoop, this);
+Worker::Worker(size_t threadCount)
+    : m_nextQueue(0)
+    , m_pending(0)
+    , m_sleeping(0)
+    , m_steals(0)
+    , m_running(true)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        m_queues.push_back(std::make_unique<ThreadQueue>());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&Worker::threadLoop, this, i);
+    }
 }
 
 Worker::~Worker() {
@@ -16,35 +41,123 @@ Worker::~Worker() {
         m_running = false;
         m_condition.notify_all();
     }
-    if (m_workerThread.joinable()) {
-        m_workerThread.join();
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
 }
 
 std::future<void> Worker::postTask(std::function<void()> task) {
     std::packaged_task<void()> packaged_task(std::move(task)); // Move the std::function into packaged_task
     std::future<void> future = packaged_task.get_future();
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_tasks.push(std::move(packaged_task));
+    post(std::move(packaged_task));
+    return future;
+}
+
+std::future<void> Worker::postTaskOn(const Queue& queue, std::function<void()> task) {
+    std::packaged_task<void()> packaged_task(std::move(task));
+    std::future<void> future = packaged_task.get_future();
+    postOn(queue, std::move(packaged_task));
+    return future;
+}
+
+void Worker::post(WorkerTask task) {
+    // Caught here rather than on a pool thread, where invoking it would crash
+    if (!task) {
+        throw std::runtime_error("Cannot post an empty WorkerTask");
+    }
+    const size_t index = t_worker == this ? t_index : m_nextQueue.fetch_add(1) % m_queues.size();
+    // Counted before it becomes visible, so the pop that takes it can never drive the
+    // counter below zero; a thread that sees the count first yields until the push lands
+    m_pending++;
+    m_queues[index]->tasks.push(std::move(task));
+    // A thread going to sleep counts itself before checking m_pending, so either it
+    // sees the task or we see it and wake it up
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
         m_condition.notify_one();
     }
-    return future;
 }
 
-void Worker::threadLoop() {
+void Worker::postOn(const Queue& queue, WorkerTask task) {
+    if (!task) {
+        throw std::runtime_error("Cannot post an empty WorkerTask");
+    }
+    const std::shared_ptr<Queue::State>& state = queue.m_state;
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->tasks.pushBack(std::move(task));
+        schedule = !state->scheduled;
+        state->scheduled = true;
+    }
+    if (schedule) {
+        post([this, state]() { drain(state); });
+    }
+}
+
+void Worker::drain(std::shared_ptr<Queue::State> state) {
     while (true) {
-        std::packaged_task<void()> task;
+        WorkerTask task;
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_condition.wait(lock, [this] { return !m_tasks.empty() || !m_running; });
-
-            if (!m_running && m_tasks.empty()) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->tasks.empty()) {
+                state->scheduled = false;
                 return;
             }
-            task = std::move(m_tasks.front());
-            m_tasks.pop();
+            task = state->tasks.popFront();
         }
+        run(task);
+    }
+}
+
+void Worker::run(WorkerTask& task) {
+    // postTask() futures capture their exceptions; this is for post()
+    try {
         task();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Worker task failed: %s", e.what());
+    } catch (...) {
+        LOG_ERROR("Worker task failed with an unknown exception");
+    }
+}
+
+bool Worker::tryPop(size_t index, WorkerTask& task) {
+    const size_t count = m_queues.size();
+    // Own queue first, then steal from the others
+    for (size_t i = 0; i < count; i++) {
+        if (m_queues[(index + i) % count]->tasks.tryPop(task)) {
+            if (i != 0) {
+                m_steals++;
+            }
+            m_pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Worker::threadLoop(size_t index) {
+    t_worker = this;
+    t_index = index;
+    while (true) {
+        WorkerTask task;
+        if (tryPop(index, task)) {
+            run(task);
+            continue;
+        }
+        if (m_pending.load() > 0) {
+            // A push is half done or another thread is taking the task: neither is worth parking for
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping++;
+        m_condition.wait(lock, [this] { return m_pending.load() > 0 || !m_running; });
+        m_sleeping--;
+        if (!m_running && m_pending.load() == 0) {
+            return;
+        }
     }
 }
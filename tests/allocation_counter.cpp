@@ -0,0 +1,51 @@
+#include "allocation_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocations{0};
+static thread_local uint64_t t_allocations = 0;
+static thread_local bool t_excluded = false;
+
+uint64_t getAllocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t getThreadAllocationCount() {
+    return t_allocations;
+}
+
+void excludeThreadFromAllocationCount() {
+    t_excluded = true;
+}
+
+void* operator new(size_t size) {
+    if (!t_excluded) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    t_allocations++;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
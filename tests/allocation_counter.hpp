@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocation counts for the benchmarks and allocation tests. Linking
+// allocation_counter.cpp replaces the global operator new and delete; it lives in a
+// translation unit of its own so they are never inlined into a caller, where GCC
+// would see free() paired with operator new and warn (-Wmismatched-new-delete).
+
+// Allocations made so far by every thread that hasn't excluded itself
+uint64_t getAllocationCount();
+// Allocations made by the calling thread so far
+uint64_t getThreadAllocationCount();
+// Leaves the calling thread's allocations out of getAllocationCount(), for threads
+// that only exist to serve the code being measured
+void excludeThreadFromAllocationCount();
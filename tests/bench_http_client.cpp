@@ -0,0 +1,166 @@
+// Throughput and latency benchmark for HttpClient against the loopback server.
+//
+//   bench_http_client [--requests N] [--size BYTES] [--mode single|pooled|batch|async|all]
+//
+// single  sends Connection: close, so every request pays for a new connection
+// pooled  reuses keep-alive connections from the pool, one request at a time
+// batch   runs everything through getBatch()
+// async   starts every request with getAsync() and then waits for all futures
+//
+// allocs/req counts the client's allocations, its I/O thread included; the loopback
+// server runs in-process, but its threads are left out of the count.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include "allocation_counter.hpp"
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_latency.hpp"
+#include "platform/logger.h"
+#include "platform/state_manager.h"
+
+struct BenchResult {
+    size_t requests = 0;
+    size_t failures = 0;
+    std::chrono::steady_clock::duration elapsed{};
+    HttpLatencyHistogram latency;
+    uint64_t allocations = 0;
+};
+
+static void report(const char* mode, const BenchResult& result) {
+    double seconds = std::chrono::duration<double>(result.elapsed).count();
+    std::printf("%-7s %6zu req %4zu fail %10.0f req/s  p50 %7lld us  p99 %7lld us  %8.1f allocs/req\n",
+                mode, result.requests, result.failures,
+                seconds > 0 ? static_cast<double>(result.requests) / seconds : 0.0,
+                static_cast<long long>(result.latency.percentile(0.50).count()),
+                static_cast<long long>(result.latency.percentile(0.99).count()),
+                result.requests > 0 ? static_cast<double>(result.allocations) / static_cast<double>(result.requests) : 0.0);
+}
+
+static BenchResult runSequential(HttpClient& client, const std::string& url, size_t requests,
+                                 const std::map<std::string, std::string>& params,
+                                 const std::map<std::string, std::string>& headers) {
+    BenchResult result;
+    result.requests = requests;
+    uint64_t allocationsBefore = getAllocationCount();
+    auto started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        try {
+            HttpResponse response = client.get(url, params, headers);
+            result.latency.record(response.timing.total);
+        } catch (const std::exception&) {
+            result.failures++;
+        }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - started;
+    result.allocations = getAllocationCount() - allocationsBefore;
+    return result;
+}
+
+static BenchResult runBatch(HttpClient& client, const std::string& url, size_t requests,
+                            const std::map<std::string, std::string>& params) {
+    std::vector<HttpRequest> batch(requests);
+    for (HttpRequest& request : batch) {
+        request.url = url;
+        request.params = params;
+    }
+    BenchResult result;
+    result.requests = requests;
+    uint64_t allocationsBefore = getAllocationCount();
+    auto started = std::chrono::steady_clock::now();
+    std::vector<HttpResult> results = client.getBatch(std::move(batch));
+    result.elapsed = std::chrono::steady_clock::now() - started;
+    result.allocations = getAllocationCount() - allocationsBefore;
+    for (const HttpResult& item : results) {
+        if (item.ok()) {
+            result.latency.record(item.response.timing.total);
+        } else {
+            result.failures++;
+        }
+    }
+    return result;
+}
+
+static BenchResult runAsync(HttpClient& client, const std::string& url, size_t requests,
+                            const std::map<std::string, std::string>& params) {
+    BenchResult result;
+    result.requests = requests;
+    std::vector<std::future<HttpResponse>> futures;
+    futures.reserve(requests);
+    uint64_t allocationsBefore = getAllocationCount();
+    auto started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        futures.push_back(client.getAsync(url, params, {}));
+    }
+    for (std::future<HttpResponse>& future : futures) {
+        try {
+            result.latency.record(future.get().timing.total);
+        } catch (const std::exception&) {
+            result.failures++;
+        }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - started;
+    result.allocations = getAllocationCount() - allocationsBefore;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    g_logger = LoggerFactory::createLogger().release();
+    size_t requests = 2000;
+    std::string size = "1024";
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--requests") == 0) {
+            requests = static_cast<size_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--size") == 0) {
+            size = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--mode") == 0) {
+            mode = argv[i + 1];
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "bench_http_client";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server(false, excludeThreadFromAllocationCount);
+    HttpClient client;
+    const std::string url = server.baseUrl() + "/bytes";
+    const std::map<std::string, std::string> params = {{"size", size}};
+
+    // Warm the pool so the first measured request doesn't pay for the connection
+    client.get(url, params, {});
+
+    size_t failures = 0;
+    if (mode == "all" || mode == "single") {
+        BenchResult result = runSequential(client, url, requests, params, {{"Connection", "close"}});
+        report("single", result);
+        failures += result.failures;
+    }
+    if (mode == "all" || mode == "pooled") {
+        BenchResult result = runSequential(client, url, requests, params, {});
+        report("pooled", result);
+        failures += result.failures;
+    }
+    if (mode == "all" || mode == "batch") {
+        BenchResult result = runBatch(client, url, requests, params);
+        report("batch", result);
+        failures += result.failures;
+    }
+    if (mode == "all" || mode == "async") {
+        BenchResult result = runAsync(client, url, requests, params);
+        report("async", result);
+        failures += result.failures;
+    }
+    std::printf("server: %llu requests on %llu connections\n",
+                static_cast<unsigned long long>(server.getRequestCount()),
+                static_cast<unsigned long long>(server.getConnectionCount()));
+    return failures == 0 ? 0 : 1;
+}
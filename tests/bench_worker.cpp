@@ -0,0 +1,104 @@
+// Cost of handing small tasks to the Worker pool.
+//
+//   bench_worker [--tasks N] [--threads N] [--mode future|post|queue-future|queue|all]
+//
+// future        postTask(): std::function + packaged_task + future per task (the old path)
+// post          post(): fire-and-forget WorkerTask, small lambdas stored inline
+// queue-future  postTaskOn() onto one serial Worker::Queue
+// queue         postOn() onto one serial Worker::Queue
+//
+// Every task bumps a counter; a run ends when the pool has executed all of them.
+// Allocations are counted on every thread, pool threads included.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include "allocation_counter.hpp"
+#include "platform/logger.h"
+#include "platform/worker.hpp"
+
+struct BenchResult {
+    size_t tasks = 0;
+    std::chrono::steady_clock::duration elapsed{};
+    uint64_t allocations = 0;
+};
+
+static void report(const char* mode, const BenchResult& result) {
+    double nanoseconds = std::chrono::duration<double, std::nano>(result.elapsed).count();
+    double tasks = static_cast<double>(result.tasks);
+    std::printf("%-12s %8zu tasks %10.0f tasks/s %8.1f ns/task %8.2f allocs/task\n",
+                mode, result.tasks,
+                nanoseconds > 0 ? tasks * 1e9 / nanoseconds : 0.0,
+                tasks > 0 ? nanoseconds / tasks : 0.0,
+                tasks > 0 ? static_cast<double>(result.allocations) / tasks : 0.0);
+}
+
+// Posts `tasks` tasks through `postOne` and waits until all have run. The first pass
+// warms up the queues so their buffers have grown to size before measuring.
+static BenchResult run(size_t tasks, const std::function<void(std::atomic<size_t>&)>& postOne) {
+    BenchResult result;
+    for (int pass = 0; pass < 2; pass++) {
+        std::atomic<size_t> done{0};
+        const uint64_t allocations = getAllocationCount();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < tasks; i++) {
+            postOne(done);
+        }
+        while (done.load() < tasks) {
+            std::this_thread::yield();
+        }
+        result.tasks = tasks;
+        result.elapsed = std::chrono::steady_clock::now() - start;
+        result.allocations = getAllocationCount() - allocations;
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    g_logger = LoggerFactory::createLogger().release();
+    size_t tasks = 200000;
+    size_t threads = 0;
+    std::string mode = "all";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--tasks") == 0) {
+            tasks = static_cast<size_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = static_cast<size_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--mode") == 0) {
+            mode = argv[i + 1];
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    Worker worker(threads);
+    Worker::Queue queue;
+    std::printf("%zu threads\n", worker.getThreadCount());
+
+    if (mode == "all" || mode == "future") {
+        report("future", run(tasks, [&](std::atomic<size_t>& done) {
+            worker.postTask([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }));
+    }
+    if (mode == "all" || mode == "post") {
+        report("post", run(tasks, [&](std::atomic<size_t>& done) {
+            worker.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }));
+    }
+    if (mode == "all" || mode == "queue-future") {
+        report("queue-future", run(tasks, [&](std::atomic<size_t>& done) {
+            worker.postTaskOn(queue, [&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }));
+    }
+    if (mode == "all" || mode == "queue") {
+        report("queue", run(tasks, [&](std::atomic<size_t>& done) {
+            worker.postOn(queue, [&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        }));
+    }
+    return 0;
+}
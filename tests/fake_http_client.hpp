@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include "platform/http_client.hpp"
+
+// IHttpClient answering from a function instead of the network, for testing decorators.
+// The handler runs on the calling thread and may block to hold a request in flight.
+class FakeHttpClient : public IHttpClient {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest& request)>;
+
+    explicit FakeHttpClient(Handler handler) : m_handler(std::move(handler)), m_calls(0) {}
+
+    HttpResponse get(const std::string& url,
+                     const std::map<std::string, std::string>& params,
+                     const std::map<std::string, std::string>& headers) override {
+        HttpRequest request;
+        request.url = url;
+        request.params = params;
+        request.headers = headers;
+        return this->request(request);
+    }
+
+    HttpResponse request(const HttpRequest& request) override {
+        m_calls++;
+        return m_handler(request);
+    }
+
+    int getCallCount() const { return m_calls.load(); }
+
+private:
+    Handler m_handler;
+    std::atomic<int> m_calls;
+};
+
+// A response with the given body and headers, sized as the real client would report it
+inline HttpResponse makeResponse(const std::string& body, const std::map<std::string, std::string>& headers = {},
+                                 int status = 200) {
+    HttpResponse response;
+    response.status_code = status;
+    response.text = body;
+    for (const auto& header : headers) {
+        response.headers.add(header.first, header.second);
+    }
+    response.wire_bytes = body.size();
+    response.decoded_bytes = body.size();
+    return response;
+}
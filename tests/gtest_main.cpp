@@ -0,0 +1,19 @@
+// Entry point shared by the test binaries. The code under test logs through g_logger,
+// which only the app's main() sets up, so install the platform logger before any test runs.
+#include <gtest/gtest.h>
+#include "platform/logger.h"
+
+class LoggerEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override {
+        if (!g_logger) {
+            g_logger = LoggerFactory::createLogger().release();
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    ::testing::AddGlobalTestEnvironment(new LoggerEnvironment());
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,615 @@
+#include "http_test_server.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+class LoopbackHttpServer::Connection {
+public:
+    Connection(int fd, SSL* ssl) : m_fd(fd), m_ssl(ssl), m_pos(0) {}
+    ~Connection() {
+        if (m_ssl) {
+            SSL_free(m_ssl);
+        }
+    }
+
+    bool readLine(std::string& line) {
+        while (true) {
+            size_t end = m_buffer.find("\r\n", m_pos);
+            if (end != std::string::npos) {
+                line.assign(m_buffer, m_pos, end - m_pos);
+                m_pos = end + 2;
+                return true;
+            }
+            if (!fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool readExact(size_t count, std::string& out) {
+        while (m_buffer.size() - m_pos < count) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out.append(m_buffer, m_pos, count);
+        m_pos += count;
+        return true;
+    }
+
+    bool writeAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int n = m_ssl
+                ? SSL_write(m_ssl, data.data() + sent, static_cast<int>(data.size() - sent))
+                : static_cast<int>(::send(m_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL));
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        if (m_pos > 0) {
+            m_buffer.erase(0, m_pos);
+            m_pos = 0;
+        }
+        char chunk[16384];
+        int n = m_ssl ? SSL_read(m_ssl, chunk, sizeof(chunk))
+                      : static_cast<int>(::recv(m_fd, chunk, sizeof(chunk), 0));
+        if (n <= 0) {
+            return false;
+        }
+        m_buffer.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    int m_fd;
+    SSL* m_ssl;
+    std::string m_buffer;
+    size_t m_pos;
+};
+
+static std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+static std::string percentDecode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size()) {
+            out.push_back(static_cast<char>(std::strtol(s.substr(i + 1, 2).c_str(), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(s[i] == '+' ? ' ' : s[i]);
+        }
+    }
+    return out;
+}
+
+static std::string gzipCompress(const std::string& data) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // windowBits 15 + 16 selects the gzip wrapper
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static long queryNumber(const LoopbackRequest& request, const std::string& name, long fallback) {
+    auto it = request.query.find(name);
+    return it == request.query.end() ? fallback : std::strtol(it->second.c_str(), nullptr, 10);
+}
+
+LoopbackHttpServer::LoopbackHttpServer(bool tls, std::function<void()> onThreadStart)
+    : m_listenFd(-1)
+    , m_port(0)
+    , m_sslContext(nullptr)
+    , m_onThreadStart(std::move(onThreadStart))
+    , m_running(true)
+    , m_requests(0)
+    , m_connections(0)
+    , m_webSockets(0)
+{
+    // A client hanging up mid-response must not kill the test process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (tls) {
+        setupTls();
+    }
+
+    m_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) {
+        throw std::runtime_error("Failed to create the test server socket");
+    }
+    int reuse = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // Any free port
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(m_listenFd, 256) != 0) {
+        ::close(m_listenFd);
+        throw std::runtime_error("Failed to bind the test server to 127.0.0.1");
+    }
+    socklen_t length = sizeof(address);
+    getsockname(m_listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+    m_port = ntohs(address.sin_port);
+
+    m_acceptThread = std::thread(&LoopbackHttpServer::acceptLoop, this);
+}
+
+LoopbackHttpServer::~LoopbackHttpServer() {
+    m_running = false;
+    ::shutdown(m_listenFd, SHUT_RDWR);
+    ::close(m_listenFd);
+    if (m_acceptThread.joinable()) {
+        m_acceptThread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        for (int fd : m_openFds) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (std::thread& thread : m_connectionThreads) {
+        thread.join();
+    }
+    if (m_sslContext) {
+        SSL_CTX_free(m_sslContext);
+    }
+}
+
+std::string LoopbackHttpServer::baseUrl() const {
+    return std::string(m_sslContext ? "https" : "http") + "://127.0.0.1:" + std::to_string(m_port);
+}
+
+void LoopbackHttpServer::setHandler(Handler handler) {
+    std::lock_guard<std::mutex> lock(m_handlerMutex);
+    m_handler = std::move(handler);
+}
+
+void LoopbackHttpServer::setupTls() {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (!keyContext || EVP_PKEY_keygen_init(keyContext) <= 0
+        || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0
+        || EVP_PKEY_keygen(keyContext, &key) <= 0) {
+        EVP_PKEY_CTX_free(keyContext);
+        throw std::runtime_error("Failed to generate the test server key");
+    }
+    EVP_PKEY_CTX_free(keyContext);
+
+    X509* certificate = X509_new();
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 3600);
+    X509_set_pubkey(certificate, key);
+    X509_NAME* name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    X509V3_CTX extensionContext;
+    X509V3_set_ctx_nodb(&extensionContext);
+    X509V3_set_ctx(&extensionContext, certificate, certificate, nullptr, nullptr, 0);
+    X509_EXTENSION* altNames = X509V3_EXT_conf_nid(nullptr, &extensionContext, NID_subject_alt_name,
+                                                   const_cast<char*>("IP:127.0.0.1,DNS:localhost"));
+    X509_add_ext(certificate, altNames, -1);
+    X509_EXTENSION_free(altNames);
+    X509_sign(certificate, key, EVP_sha256());
+
+    BIO* pem = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(pem, certificate);
+    char* pemData = nullptr;
+    long pemLength = BIO_get_mem_data(pem, &pemData);
+    m_certificatePem.assign(pemData, static_cast<size_t>(pemLength));
+    BIO_free(pem);
+
+    m_sslContext = SSL_CTX_new(TLS_server_method());
+    bool ok = m_sslContext
+        && SSL_CTX_use_certificate(m_sslContext, certificate) == 1
+        && SSL_CTX_use_PrivateKey(m_sslContext, key) == 1;
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    if (!ok) {
+        throw std::runtime_error("Failed to set up the test server TLS context");
+    }
+}
+
+void LoopbackHttpServer::acceptLoop() {
+    if (m_onThreadStart) {
+        m_onThreadStart();
+    }
+    while (m_running) {
+        int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (!m_running) {
+                break;
+            }
+            continue;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        m_connections++;
+        std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        m_openFds.insert(fd);
+        m_connectionThreads.emplace_back(&LoopbackHttpServer::serve, this, fd);
+    }
+}
+
+void LoopbackHttpServer::serve(int fd) {
+    if (m_onThreadStart) {
+        m_onThreadStart();
+    }
+    SSL* ssl = nullptr;
+    bool ready = true;
+    if (m_sslContext) {
+        ssl = SSL_new(m_sslContext);
+        SSL_set_fd(ssl, fd);
+        ready = SSL_accept(ssl) == 1;
+    }
+    if (ready) {
+        Connection connection(fd, ssl); // Owns ssl from here on
+        while (m_running && handleOne(connection)) {
+        }
+    } else {
+        SSL_free(ssl);
+    }
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    m_openFds.erase(fd);
+    ::close(fd);
+}
+
+bool LoopbackHttpServer::handleOne(Connection& connection) {
+    std::string line;
+    if (!connection.readLine(line) || line.empty()) {
+        return false;
+    }
+
+    LoopbackRequest request;
+    size_t firstSpace = line.find(' ');
+    size_t secondSpace = line.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        return false;
+    }
+    request.method = line.substr(0, firstSpace);
+    std::string target = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if (question != std::string::npos) {
+        std::string query = target.substr(question + 1);
+        size_t start = 0;
+        while (start <= query.size()) {
+            size_t end = query.find('&', start);
+            std::string pair = query.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            size_t equals = pair.find('=');
+            if (!pair.empty()) {
+                request.query[percentDecode(pair.substr(0, equals))] =
+                    equals == std::string::npos ? "" : percentDecode(pair.substr(equals + 1));
+            }
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+    }
+
+    while (connection.readLine(line) && !line.empty()) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        request.headers[toLower(line.substr(0, colon))] = value;
+    }
+
+    if (toLower(request.headers["upgrade"]) == "websocket") {
+        m_requests++;
+        serveWebSocket(connection, request);
+        return false;
+    }
+    if (toLower(request.headers["expect"]) == "100-continue") {
+        connection.writeAll("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+    if (toLower(request.headers["transfer-encoding"]) == "chunked") {
+        while (connection.readLine(line)) {
+            size_t size = std::strtoul(line.c_str(), nullptr, 16);
+            if (size == 0) {
+                connection.readLine(line);
+                break;
+            }
+            std::string crlf;
+            if (!connection.readExact(size, request.body) || !connection.readExact(2, crlf)) {
+                return false;
+            }
+        }
+    } else if (request.headers.count("content-length")) {
+        size_t length = std::strtoul(request.headers["content-length"].c_str(), nullptr, 10);
+        if (!connection.readExact(length, request.body)) {
+            return false;
+        }
+    }
+    m_requests++;
+
+    LoopbackResponse response;
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_handlerMutex);
+        handler = m_handler;
+    }
+    if (handler) {
+        handler(request, response);
+    } else {
+        builtinRoutes(request, response);
+    }
+
+    if (response.delay.count() > 0) {
+        std::this_thread::sleep_for(response.delay);
+    }
+    if (response.drop) {
+        return false;
+    }
+    if (response.malformed) {
+        connection.writeAll("HTTP/1.1 abc\r\nthis is not a header\r\n\r\n");
+        return false;
+    }
+
+    std::string body = std::move(response.body);
+    if (response.gzip && request.headers["accept-encoding"].find("gzip") != std::string::npos) {
+        body = gzipCompress(body);
+        response.headers["Content-Encoding"] = "gzip";
+    }
+    const bool close = toLower(request.headers["connection"]) == "close";
+    const bool head = request.method == "HEAD";
+
+    std::string header = "HTTP/1.1 " + std::to_string(response.status) + " Test\r\n";
+    for (const auto& kv : response.headers) {
+        header += kv.first + ": " + kv.second + "\r\n";
+    }
+    if (close) {
+        header += "Connection: close\r\n";
+    }
+    if (response.chunkSize > 0) {
+        header += "Transfer-Encoding: chunked\r\n\r\n";
+        if (!connection.writeAll(header)) {
+            return false;
+        }
+        for (size_t offset = 0; !head && offset < body.size(); offset += response.chunkSize) {
+            if (offset > 0 && response.chunkDelay.count() > 0) {
+                std::this_thread::sleep_for(response.chunkDelay);
+            }
+            size_t size = std::min(response.chunkSize, body.size() - offset);
+            char sizeLine[32];
+            std::snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", size);
+            if (!connection.writeAll(sizeLine + body.substr(offset, size) + "\r\n")) {
+                return false;
+            }
+        }
+        if (!head && !connection.writeAll("0\r\n\r\n")) {
+            return false;
+        }
+    } else {
+        header += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+        if (!connection.writeAll(head ? header : header + body)) {
+            return false;
+        }
+    }
+    return !close;
+}
+
+void LoopbackHttpServer::builtinRoutes(const LoopbackRequest& request, LoopbackResponse& response) {
+    response.delay = std::chrono::milliseconds(queryNumber(request, "delay_ms", 0));
+    response.chunkSize = static_cast<size_t>(queryNumber(request, "chunk", 0));
+    response.chunkDelay = std::chrono::milliseconds(queryNumber(request, "chunk_delay_ms", 0));
+    response.gzip = queryNumber(request, "gzip", 0) != 0;
+
+    if (request.path == "/bytes") {
+        static const std::string pattern = "{\"id\":12345,\"name\":\"loopback\",\"tags\":[\"a\",\"b\"]}\n";
+        size_t size = static_cast<size_t>(queryNumber(request, "size", 1024));
+        response.body.reserve(size);
+        while (response.body.size() < size) {
+            response.body.append(pattern, 0, std::min(pattern.size(), size - response.body.size()));
+        }
+        response.headers["Content-Type"] = "application/json";
+    } else if (request.path == "/status") {
+        response.status = static_cast<int>(queryNumber(request, "code", 200));
+        auto retryAfter = request.query.find("retry_after");
+        if (retryAfter != request.query.end()) {
+            response.headers["Retry-After"] = retryAfter->second;
+        }
+    } else if (request.path == "/flaky") {
+        int hit = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_handlerMutex);
+            hit = ++m_flakyHits[request.query.count("id") ? request.query.at("id") : ""];
+        }
+        if (hit <= queryNumber(request, "failures", 1)) {
+            response.status = 503;
+            response.headers["Retry-After"] = "0";
+        }
+        response.body = "attempt " + std::to_string(hit);
+    } else if (request.path == "/echo") {
+        response.body = request.body;
+        response.headers["X-Method"] = request.method;
+        auto contentType = request.headers.find("content-type");
+        response.headers["X-Content-Type"] = contentType == request.headers.end() ? "" : contentType->second;
+    } else if (request.path == "/redirect") {
+        response.status = 307;
+        auto to = request.query.find("to");
+        response.headers["Location"] = to == request.query.end() ? "/" : to->second;
+    } else if (request.path == "/drop") {
+        response.drop = true;
+    } else if (request.path == "/malformed") {
+        response.malformed = true;
+    } else {
+        response.status = 404;
+    }
+}
+
+static std::string webSocketFrame(unsigned char firstByte, const std::string& payload) {
+    std::string frame(1, static_cast<char>(firstByte));
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() < 65536) {
+        frame.push_back(static_cast<char>(126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size() & 0xff));
+    } else {
+        frame.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xff));
+        }
+    }
+    return frame + payload;
+}
+
+void LoopbackHttpServer::serveWebSocket(Connection& connection, const LoopbackRequest& request) {
+    auto key = request.headers.find("sec-websocket-key");
+    if (key == request.headers.end()) {
+        connection.writeAll("HTTP/1.1 400 Test\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+    const std::string accept = key->second + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    EVP_Digest(accept.data(), accept.size(), digest, &digestLength, EVP_sha1(), nullptr);
+    char encoded[64];
+    EVP_EncodeBlock(reinterpret_cast<unsigned char*>(encoded), digest, static_cast<int>(digestLength));
+
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + std::string(encoded) + "\r\n";
+    auto protocol = request.headers.find("sec-websocket-protocol");
+    if (protocol != request.headers.end()) {
+        response += "Sec-WebSocket-Protocol: " + protocol->second + "\r\n";
+    }
+    if (!connection.writeAll(response + "\r\n")) {
+        return;
+    }
+    m_webSockets++;
+
+    std::string message;
+    unsigned char messageOpcode = 0;
+    bool muted = false;
+    while (m_running) {
+        std::string header;
+        if (!connection.readExact(2, header)) {
+            return;
+        }
+        const bool fin = (header[0] & 0x80) != 0;
+        const unsigned char opcode = header[0] & 0x0f;
+        uint64_t length = header[1] & 0x7f;
+        std::string extended;
+        if (length >= 126) {
+            const size_t bytes = length == 126 ? 2 : 8;
+            if (!connection.readExact(bytes, extended)) {
+                return;
+            }
+            length = 0;
+            for (char c : extended) {
+                length = (length << 8) | static_cast<unsigned char>(c);
+            }
+        }
+        std::string mask;
+        std::string payload;
+        if (!connection.readExact(4, mask) || !connection.readExact(static_cast<size_t>(length), payload)) {
+            return;
+        }
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+        }
+
+        if (muted) {
+            continue;
+        }
+        if (opcode == 0x8) {
+            connection.writeAll(webSocketFrame(0x88, payload.substr(0, 2)));
+            return;
+        }
+        if (opcode == 0x9) {
+            connection.writeAll(webSocketFrame(0x8a, payload));
+            continue;
+        }
+        if (opcode == 0xa) {
+            connection.writeAll(webSocketFrame(0x81, "pong"));
+            continue;
+        }
+        if (opcode != 0x0) {
+            messageOpcode = opcode;
+            message.clear();
+        }
+        message += payload;
+        if (!fin) {
+            continue;
+        }
+
+        if (messageOpcode == 0x1 && message.rfind("burst ", 0) == 0) {
+            std::string frames;
+            const long count = std::strtol(message.c_str() + 6, nullptr, 10);
+            for (long i = 0; i < count; ++i) {
+                frames += webSocketFrame(0x81, "message " + std::to_string(i));
+            }
+            connection.writeAll(frames);
+        } else if (messageOpcode == 0x1 && message.rfind("fragmented ", 0) == 0) {
+            const size_t size = std::strtoul(message.c_str() + 11, nullptr, 10);
+            std::string data(size, '\0');
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = static_cast<char>(i % 251);
+            }
+            const size_t third = size / 3;
+            connection.writeAll(webSocketFrame(0x02, data.substr(0, third))
+                                + webSocketFrame(0x00, data.substr(third, third))
+                                + webSocketFrame(0x80, data.substr(2 * third)));
+        } else if (messageOpcode == 0x1 && message == "ping") {
+            connection.writeAll(webSocketFrame(0x89, "p"));
+        } else if (messageOpcode == 0x1 && message.rfind("last ", 0) == 0) {
+            std::string frames;
+            const long count = std::strtol(message.c_str() + 5, nullptr, 10);
+            for (long i = 0; i < count; ++i) {
+                frames += webSocketFrame(0x81, "last " + std::to_string(i));
+            }
+            connection.writeAll(frames + webSocketFrame(0x88, std::string("\x03\xe8", 2)));
+            return;
+        } else if (messageOpcode == 0x1 && message.rfind("cut ", 0) == 0) {
+            const size_t size = std::strtoul(message.c_str() + 4, nullptr, 10);
+            connection.writeAll(webSocketFrame(0x02, std::string(size, 'c')));
+            return;
+        } else if (messageOpcode == 0x1 && message == "drop") {
+            return;
+        } else if (messageOpcode == 0x1 && message == "mute") {
+            muted = true;
+        } else {
+            connection.writeAll(webSocketFrame(0x80 | messageOpcode, message));
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef struct ssl_ctx_st SSL_CTX;
+
+struct LoopbackRequest {
+    std::string method;
+    std::string path;                          // Without the query string
+    std::map<std::string, std::string> query;  // Decoded
+    std::map<std::string, std::string> headers; // Names lower-cased
+    std::string body;
+};
+
+struct LoopbackResponse {
+    int status = 200;
+    std::map<std::string, std::string> headers;
+    std::string body;
+    size_t chunkSize = 0;                    // > 0 sends the body chunked in pieces of this size
+    std::chrono::milliseconds delay{0};      // Before the status line
+    std::chrono::milliseconds chunkDelay{0}; // Between chunks
+    bool gzip = false;                       // Only honoured if the client accepts gzip
+    bool drop = false;                       // Close the connection without answering
+    bool malformed = false;                  // Answer with a broken status line
+};
+
+// In-process HTTP/1.1 server on 127.0.0.1 for tests and benchmarks, with
+// optional TLS using a self-signed certificate generated at startup. Every
+// connection gets its own thread and is kept alive unless asked otherwise.
+//
+// Without a custom handler the server answers these routes, and every route
+// also accepts delay_ms, chunk (chunk size), chunk_delay_ms and gzip=1:
+//   /bytes?size=N               N bytes of compressible text
+//   /status?code=C&retry_after=S
+//   /flaky?id=X&failures=N      503 for the first N hits of id X, then 200
+//   /echo                       the request body, with X-Method and X-Content-Type
+//   /redirect?to=PATH           307 to PATH, so the client has to resend its body
+//   /drop                       closes the connection without a response
+//   /malformed                  answers with an invalid status line
+//
+// Requests asking for "Upgrade: websocket" get a WebSocket echo server instead,
+// whatever the handler. It echoes messages and understands these text commands:
+//   burst N          N text messages "message <i>" in a single write
+//   fragmented N     an N-byte binary message split over three frames
+//   ping             sends a ping and answers "pong" once the client's pong arrives
+//   drop             closes the connection without a close frame
+//   last N           N text messages "last <i>", then a close frame
+//   cut N            the first N-byte binary fragment of a message, then closes the connection
+//   mute             reads but no longer answers anything, pings included
+class LoopbackHttpServer {
+public:
+    using Handler = std::function<void(const LoopbackRequest& request, LoopbackResponse& response)>;
+
+    // Throws std::runtime_error if the socket or TLS setup fails. onThreadStart (optional)
+    // runs first on every thread the server starts, e.g. to keep it out of measurements.
+    explicit LoopbackHttpServer(bool tls = false, std::function<void()> onThreadStart = nullptr);
+    ~LoopbackHttpServer();
+
+    LoopbackHttpServer(const LoopbackHttpServer&) = delete;
+    LoopbackHttpServer& operator=(const LoopbackHttpServer&) = delete;
+
+    int port() const { return m_port; }
+    // "http://127.0.0.1:<port>" or "https://..."
+    std::string baseUrl() const;
+    // PEM of the self-signed certificate; empty without TLS
+    const std::string& certificatePem() const { return m_certificatePem; }
+
+    // Replaces the built-in routes. Runs on connection threads.
+    void setHandler(Handler handler);
+
+    uint64_t getRequestCount() const { return m_requests.load(); }
+    uint64_t getConnectionCount() const { return m_connections.load(); }
+    uint64_t getWebSocketCount() const { return m_webSockets.load(); }
+
+private:
+    class Connection;
+
+    void acceptLoop();
+    void serve(int fd);
+    bool handleOne(Connection& connection);
+    void setupTls();
+    void builtinRoutes(const LoopbackRequest& request, LoopbackResponse& response);
+    void serveWebSocket(Connection& connection, const LoopbackRequest& request);
+
+    int m_listenFd;
+    int m_port;
+    SSL_CTX* m_sslContext;
+    std::string m_certificatePem;
+    Handler m_handler;
+    std::function<void()> m_onThreadStart;
+    std::mutex m_handlerMutex;
+    std::map<std::string, int> m_flakyHits; // Guarded by m_handlerMutex
+
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_requests;
+    std::atomic<uint64_t> m_connections;
+    std::atomic<uint64_t> m_webSockets;
+    std::thread m_acceptThread;
+    std::vector<std::thread> m_connectionThreads;
+    std::set<int> m_openFds;
+    std::mutex m_connectionsMutex;
+};
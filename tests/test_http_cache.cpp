@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "fake_http_client.hpp"
+#include "platform/http_cache.hpp"
+
+// A fresh, empty cache directory per test
+static std::string cacheDir(const std::string& name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_cache_test" / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+static uintmax_t directorySize(const std::string& dir) {
+    uintmax_t total = 0;
+    for (const auto& file : std::filesystem::directory_iterator(dir)) {
+        total += file.file_size();
+    }
+    return total;
+}
+
+TEST(CachingHttpClientTest, ServesFreshEntriesWithoutTheNetwork) {
+    FakeHttpClient inner([](const HttpRequest&) {
+        return makeResponse("hello", {{"Cache-Control", "public, max-age=60"}});
+    });
+    CachingHttpClient cache(inner, cacheDir("fresh"));
+
+    EXPECT_EQ(cache.get("http://example.com/a", {{"page", "1"}}, {}).text, "hello");
+    HttpResponse cached = cache.get("http://example.com/a", {{"page", "1"}}, {});
+    EXPECT_EQ(cached.text, "hello");
+    EXPECT_EQ(cached.headers.get("cache-control"), "public, max-age=60");
+    EXPECT_EQ(inner.getCallCount(), 1);
+
+    // Different params are a different entry
+    cache.get("http://example.com/a", {{"page", "2"}}, {});
+    EXPECT_EQ(inner.getCallCount(), 2);
+
+    HttpCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.bytesSaved, 5u);
+}
+
+TEST(CachingHttpClientTest, RevalidatesStaleEntriesWithConditionalRequests) {
+    std::string ifNoneMatch;
+    FakeHttpClient inner([&](const HttpRequest& request) {
+        auto header = request.headers.find("If-None-Match");
+        ifNoneMatch = header == request.headers.end() ? "" : header->second;
+        if (ifNoneMatch == "\"v1\"") {
+            return makeResponse("", {{"Cache-Control", "max-age=60"}}, 304);
+        }
+        return makeResponse("body", {{"ETag", "\"v1\""}, {"Cache-Control", "no-cache"}});
+    });
+    CachingHttpClient cache(inner, cacheDir("revalidate"));
+
+    cache.get("http://example.com/r", {}, {});
+    EXPECT_EQ(ifNoneMatch, "");
+    // no-cache: stored, but checked with the server before every use
+    HttpResponse revalidated = cache.get("http://example.com/r", {}, {});
+    EXPECT_EQ(ifNoneMatch, "\"v1\"");
+    EXPECT_EQ(revalidated.status_code, 200);
+    EXPECT_EQ(revalidated.text, "body");
+    // The 304's max-age replaces no-cache, so the next call doesn't go out at all
+    EXPECT_EQ(revalidated.headers.get("cache-control"), "max-age=60");
+    cache.get("http://example.com/r", {}, {});
+    EXPECT_EQ(inner.getCallCount(), 2);
+
+    HttpCacheStats stats = cache.getStats();
+    EXPECT_EQ(stats.revalidations, 1u);
+    EXPECT_EQ(stats.notModified, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.bytesSaved, 8u);
+}
+
+TEST(CachingHttpClientTest, DoesNotStoreUncacheableResponses) {
+    FakeHttpClient inner([](const HttpRequest& request) {
+        if (request.url.find("no-store") != std::string::npos) {
+            return makeResponse("secret", {{"Cache-Control", "no-store"}});
+        }
+        return makeResponse("missing", {{"Cache-Control", "max-age=60"}}, 404);
+    });
+    CachingHttpClient cache(inner, cacheDir("uncacheable"));
+    for (int i = 0; i < 2; i++) {
+        cache.get("http://example.com/no-store", {}, {});
+        cache.get("http://example.com/missing", {}, {});
+    }
+    EXPECT_EQ(inner.getCallCount(), 4);
+    EXPECT_EQ(cache.getStats().hits, 0u);
+}
+
+TEST(CachingHttpClientTest, PersistsEntriesAndEvictsTheOldestOverBudget) {
+    const std::string dir = cacheDir("disk");
+    const size_t maxDiskBytes = 8 * 1024;
+    FakeHttpClient inner([](const HttpRequest& request) {
+        return makeResponse(std::string(1024, request.url.back()), {{"Cache-Control", "max-age=60"}});
+    });
+    {
+        CachingHttpClient cache(inner, dir, 1024 * 1024, maxDiskBytes);
+        for (char c = 'a'; c <= 'z'; c++) {
+            cache.get(std::string("http://example.com/") + c, {}, {});
+        }
+        EXPECT_LE(directorySize(dir), maxDiskBytes);
+    }
+    EXPECT_LE(directorySize(dir), maxDiskBytes);
+
+    // A new instance starts with an empty memory cache and reads what survived from disk
+    const int calls = inner.getCallCount();
+    CachingHttpClient reopened(inner, dir, 1024 * 1024, maxDiskBytes);
+    EXPECT_EQ(reopened.get("http://example.com/z", {}, {}).text, std::string(1024, 'z'));
+    EXPECT_EQ(inner.getCallCount(), calls);
+    reopened.get("http://example.com/a", {}, {});
+    EXPECT_EQ(inner.getCallCount(), calls + 1);
+}
@@ -0,0 +1,384 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include "http_test_server.hpp"
+#include "platform/http_ca_store.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_latency.hpp"
+#include "platform/state_manager.h"
+
+class HttpClientTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        // Keep TLS session files and the like out of the working directory
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_client_test";
+        std::filesystem::create_directories(dir);
+        StateManager::getInstance().setInternalDataPath(dir.string());
+    }
+
+    std::string url(const std::string& pathAndQuery) const { return server.baseUrl() + pathAndQuery; }
+
+    LoopbackHttpServer server;
+    HttpClient client;
+};
+
+TEST_F(HttpClientTest, GetReturnsBodyStatusAndHeaders) {
+    HttpResponse response = client.get(url("/bytes"), {{"size", "100"}}, {});
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(response.text.size(), 100u);
+    EXPECT_EQ(response.headers.get("content-type"), "application/json");
+    EXPECT_EQ(response.headers.get("Content-Length"), "100");
+    EXPECT_FALSE(response.headers.contains("x-missing"));
+}
+
+TEST(HttpHeadersTest, IndexesOneContiguousBlock) {
+    HttpHeaders headers;
+    headers.addLine("HTTP/1.1 301 Moved Permanently\r\n");
+    headers.addLine("Location: /elsewhere\r\n");
+    // A new status line replaces the redirect's headers
+    headers.addLine("HTTP/2 200\r\n");
+    headers.addLine("content-type: text/html\r\n");
+    headers.addLine("Set-Cookie: a=1\r\n");
+    headers.addLine("SET-COOKIE:  b=2 \r\n");
+    headers.addLine("Link: <https://example.com/?page=2>; rel=\"next\"\r\n");
+    headers.addLine("\r\n");
+
+    EXPECT_FALSE(headers.contains("location"));
+    EXPECT_EQ(headers.size(), 4u);
+    EXPECT_EQ(headers.get("Content-Type"), "text/html");
+    EXPECT_EQ(headers.get("set-cookie"), "a=1");
+    EXPECT_EQ(headers.count("Set-Cookie"), 2u);
+    EXPECT_EQ(headers[2].name, "SET-COOKIE");
+    EXPECT_EQ(headers[2].value, "b=2");
+    EXPECT_EQ(headers.get("link"), "<https://example.com/?page=2>; rel=\"next\"");
+
+    // Views point into the block itself
+    const std::string& block = headers.serialize();
+    std::string_view type = headers.get("content-type");
+    EXPECT_GE(type.data(), block.data());
+    EXPECT_LE(type.data() + type.size(), block.data() + block.size());
+
+    HttpHeaders copy = HttpHeaders::parse(block);
+    EXPECT_EQ(copy, headers);
+    EXPECT_NE(copy.get("link").data(), headers.get("link").data());
+
+    HttpHeaders refreshed;
+    refreshed.add("Set-Cookie", "c=3");
+    refreshed.add("Cache-Control", "max-age=60");
+    copy.merge(refreshed);
+    EXPECT_EQ(copy.count("set-cookie"), 1u);
+    EXPECT_EQ(copy.get("set-cookie"), "c=3");
+    EXPECT_EQ(copy.get("cache-control"), "max-age=60");
+    EXPECT_EQ(copy.get("content-type"), "text/html");
+    EXPECT_EQ(copy.serialize().compare(0, 11, "HTTP/2 200\r"), 0);
+}
+
+TEST_F(HttpClientTest, ReusesKeepAliveConnections) {
+    for (int i = 0; i < 10; ++i) {
+        client.get(url("/bytes"), {}, {});
+    }
+    HttpResponse last = client.get(url("/bytes"), {}, {});
+    EXPECT_EQ(server.getConnectionCount(), 1u);
+    EXPECT_TRUE(last.timing.connection_reused);
+    EXPECT_GT(client.getPoolHits(), 0u);
+}
+
+TEST_F(HttpClientTest, ReassemblesChunkedBodies) {
+    HttpResponse response = client.get(url("/bytes"), {{"size", "10000"}, {"chunk", "777"}}, {});
+    EXPECT_EQ(response.text.size(), 10000u);
+}
+
+TEST_F(HttpClientTest, DecodesGzipAndRecordsWireBytes) {
+    HttpResponse response = client.get(url("/bytes"), {{"size", "50000"}, {"gzip", "1"}}, {});
+    EXPECT_EQ(response.headers.get("content-encoding"), "gzip");
+    EXPECT_EQ(response.text.size(), 50000u);
+    EXPECT_EQ(response.decoded_bytes, 50000u);
+    EXPECT_LT(response.wire_bytes, response.decoded_bytes / 4);
+}
+
+TEST_F(HttpClientTest, RetriesServerErrorsUntilSuccess) {
+    HttpRequest request;
+    request.url = url("/flaky?id=retry&failures=2");
+    HttpRetryPolicy policy;
+    policy.maxAttempts = 3;
+    policy.initialBackoff = std::chrono::milliseconds(1);
+    request.retryPolicy = policy;
+
+    HttpResponse response = client.request(request);
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(response.text, "attempt 3");
+    EXPECT_EQ(client.getRetryCount(), 2u);
+}
+
+TEST_F(HttpClientTest, ReturnsResponsesWhoseRetryAfterExceedsMaxBackoff) {
+    HttpRetryPolicy policy;
+    policy.maxAttempts = 3;
+    policy.initialBackoff = std::chrono::milliseconds(1);
+    for (const char* retryAfter : {"86400", "99999999999999999999", "Fri%2C%2031%20Dec%202100%2023%3A59%3A59%20GMT"}) {
+        HttpRequest request;
+        request.url = url(std::string("/status?code=503&retry_after=") + retryAfter);
+        request.retryPolicy = policy;
+
+        auto started = std::chrono::steady_clock::now();
+        HttpResponse response = client.request(request);
+        EXPECT_EQ(response.status_code, 503) << retryAfter;
+        EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(2)) << retryAfter;
+    }
+    EXPECT_EQ(client.getRetryCount(), 0u);
+}
+
+TEST_F(HttpClientTest, TotalDeadlineStopsRetries) {
+    HttpRequest request;
+    request.url = url("/bytes?delay_ms=2000");
+    HttpRetryPolicy policy;
+    policy.maxAttempts = 10;
+    policy.attemptTimeout = std::chrono::milliseconds(100);
+    policy.totalDeadline = std::chrono::milliseconds(400);
+    request.retryPolicy = policy;
+
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_THROW(client.request(request), std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(1500));
+}
+
+TEST_F(HttpClientTest, HedgesSlowRequestsOnceWarmedUp) {
+    // Hits 15 to 17 stall; every other one, the hedge of hit 17 included, answers at once
+    std::atomic<int> hits{0};
+    server.setHandler([&](const LoopbackRequest&, LoopbackResponse& response) {
+        int hit = ++hits;
+        response.body = "hit " + std::to_string(hit);
+        if (hit == 15 || hit == 16) {
+            response.delay = std::chrono::milliseconds(300);
+        } else if (hit == 17) {
+            response.delay = std::chrono::milliseconds(1500);
+        }
+    });
+    HttpRequest request;
+    request.url = url("/slow");
+    HttpRetryPolicy policy;
+    policy.hedge = true;
+    request.retryPolicy = policy;
+
+    // No hedge until the host has 16 samples, so the first stalls are waited out
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_EQ(client.request(request).status_code, 200);
+    }
+    EXPECT_EQ(client.getHedgeCount(), 0u);
+
+    // The 95th percentile is now about 300 ms: the duplicate starts after that and wins
+    auto started = std::chrono::steady_clock::now();
+    HttpResponse response = client.request(request);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    EXPECT_EQ(response.text, "hit 18");
+    EXPECT_GE(elapsed, std::chrono::milliseconds(200));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+    EXPECT_EQ(client.getHedgeCount(), 1u);
+    EXPECT_EQ(client.getHedgeWinCount(), 1u);
+
+    // The stalled leg was dropped rather than left to finish and be recorded
+    std::this_thread::sleep_until(started + std::chrono::milliseconds(1800));
+    HttpLatencyTracker& latency = client.getLatencyTracker();
+    EXPECT_EQ(latency.getTotal(latency.getHosts().front()).getCount(), 17u);
+    EXPECT_EQ(hits.load(), 18);
+}
+
+TEST_F(HttpClientTest, ReportsDroppedConnectionsAsErrors) {
+    EXPECT_THROW(client.get(url("/drop"), {}, {}), std::runtime_error);
+    EXPECT_THROW(client.get(url("/malformed"), {}, {}), std::runtime_error);
+}
+
+TEST_F(HttpClientTest, StreamSinkCanStopTheTransfer) {
+    size_t received = 0;
+    HttpResponse response = client.getStream(url("/bytes"), {{"size", "100000"}, {"chunk", "1000"}}, {},
+                                             [&](std::string_view chunk) {
+                                                 received += chunk.size();
+                                                 return false;
+                                             });
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_GT(received, 0u);
+    EXPECT_LT(received, 100000u);
+}
+
+TEST_F(HttpClientTest, BatchResultsKeepInputOrder) {
+    std::vector<HttpRequest> requests;
+    for (int i = 0; i < 12; ++i) {
+        HttpRequest request;
+        request.url = url("/bytes");
+        // Later requests answer first
+        request.params = {{"size", std::to_string(i + 1)}, {"delay_ms", std::to_string((12 - i) * 5)}};
+        requests.push_back(request);
+    }
+    HttpBatchOptions options;
+    options.maxParallel = 12;
+    options.maxPerHost = 12;
+    std::vector<HttpResult> results = client.getBatch(requests, options);
+    ASSERT_EQ(results.size(), 12u);
+    for (size_t i = 0; i < results.size(); ++i) {
+        ASSERT_TRUE(results[i].ok()) << results[i].error;
+        EXPECT_EQ(results[i].response.text.size(), i + 1);
+    }
+}
+
+TEST_F(HttpClientTest, SendsBodiesAndForms) {
+    std::string payload(200000, 'x');
+    HttpRequest post;
+    post.method = "POST";
+    post.url = url("/echo");
+    post.headers["Content-Type"] = "text/plain";
+    post.body.data = payload;
+    HttpResponse echoed = client.request(post);
+    EXPECT_EQ(echoed.headers.get("x-method"), "POST");
+    EXPECT_EQ(echoed.text, payload);
+
+    HttpRequest put;
+    put.method = "PUT";
+    put.url = url("/echo");
+    int chunks = 3;
+    put.body.reader = [&](char* buffer, size_t size) -> size_t {
+        if (chunks-- == 0) {
+            return 0;
+        }
+        buffer[0] = 'r';
+        return size > 0 ? 1 : 0;
+    };
+    EXPECT_EQ(client.request(put).text, "rrr");
+
+    HttpRequest form;
+    form.method = "POST";
+    form.url = url("/echo");
+    HttpFormPart field;
+    field.name = "field";
+    field.data = "value";
+    form.form.push_back(field);
+    HttpResponse multipart = client.request(form);
+    EXPECT_NE(multipart.headers.get("x-content-type").find("multipart/form-data"), std::string::npos);
+    EXPECT_NE(multipart.text.find("value"), std::string::npos);
+}
+
+TEST_F(HttpClientTest, UploadsFiles) {
+    std::string contents(300000, '\0');
+    for (size_t i = 0; i < contents.size(); i++) {
+        contents[i] = static_cast<char>(i % 251);
+    }
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "http_client_test" / "upload.bin";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    HttpRequest put;
+    put.method = "PUT";
+    put.url = url("/echo");
+    put.body.filePath = path.string();
+    HttpResponse echoed = client.request(put);
+    EXPECT_EQ(echoed.headers.get("x-method"), "PUT");
+    EXPECT_TRUE(echoed.text == contents);
+
+    // The 307 makes curl rewind the file through the seek callback and send it again
+    put.url = url("/redirect?to=/echo");
+    HttpResponse redirected = client.request(put);
+    EXPECT_EQ(redirected.status_code, 200);
+    EXPECT_EQ(redirected.headers.get("x-method"), "PUT");
+    EXPECT_TRUE(redirected.text == contents);
+
+    HttpRequest form;
+    form.method = "POST";
+    form.url = url("/echo");
+    HttpFormPart part;
+    part.name = "attachment";
+    part.filePath = path.string();
+    part.fileName = "renamed.bin";
+    form.form.push_back(part);
+    HttpResponse multipart = client.request(form);
+    EXPECT_NE(multipart.headers.get("x-content-type").find("multipart/form-data"), std::string::npos);
+    EXPECT_NE(multipart.text.find("name=\"attachment\"; filename=\"renamed.bin\""), std::string::npos);
+    EXPECT_NE(multipart.text.find(contents), std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST(HttpClientTlsTest, TrustsAddedCertificate) {
+    LoopbackHttpServer server(true);
+    HttpClient client;
+    EXPECT_THROW(client.get(server.baseUrl() + "/bytes", {}, {}), std::runtime_error);
+
+    ASSERT_EQ(HttpCaStore::getInstance().addCertificates(server.certificatePem()), 1u);
+    HttpResponse response = client.get(server.baseUrl() + "/bytes", {{"size", "10"}}, {});
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_GT(response.timing.app_connect.count(), 0);
+}
+
+TEST(HttpClientTlsTest, PreconnectWarmsTheFirstRequest) {
+    LoopbackHttpServer server(true);
+    HttpCaStore::getInstance().addCertificates(server.certificatePem());
+    HttpClient client;
+    std::vector<HttpPreconnectResult> results =
+        client.preconnect({server.baseUrl() + "/bytes", server.baseUrl() + "/echo", "http://127.0.0.1:1/"}).get();
+    ASSERT_EQ(results.size(), 2u); // One per origin
+    EXPECT_TRUE(results[0].ok()) << results[0].error;
+    EXPECT_GT(results[0].timing.app_connect.count(), 0);
+    EXPECT_FALSE(results[1].ok());
+
+    HttpResponse response = client.get(server.baseUrl() + "/bytes", {{"size", "10"}}, {});
+    EXPECT_TRUE(response.timing.connection_reused);
+    EXPECT_EQ(server.getConnectionCount(), 1u);
+}
+
+TEST_F(HttpClientTest, CancelTokenAbortsRequestInFlight) {
+    auto token = std::make_shared<HttpCancelToken>();
+    std::future<HttpResponse> future = client.getAsync(url("/bytes?delay_ms=1500"), {}, {}, token);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto cancelledAt = std::chrono::steady_clock::now();
+    token->cancel();
+    try {
+        future.get();
+        FAIL() << "Cancelled request succeeded";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Request cancelled");
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - cancelledAt, std::chrono::milliseconds(500));
+}
+
+TEST_F(HttpClientTest, QueuedRequestsStartByPriority) {
+    client.setMaxActiveRequests(1);
+    std::mutex mutex;
+    std::vector<std::string> finished;
+    auto submit = [&](const std::string& name, HttpPriority priority, int delayMs,
+                      std::shared_ptr<HttpCancelToken> token = nullptr) {
+        HttpRequest request;
+        request.url = url("/bytes?delay_ms=" + std::to_string(delayMs));
+        request.priority = priority;
+        request.cancelToken = token;
+        client.requestAsync(request, [&, name](HttpResult result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(result.ok() ? name : name + " failed");
+        });
+    };
+
+    submit("blocker", HttpPriority::Normal, 300);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto dropped = std::make_shared<HttpCancelToken>();
+    submit("prefetch", HttpPriority::Prefetch, 0);
+    submit("dropped", HttpPriority::Prefetch, 0, dropped);
+    submit("normal", HttpPriority::Normal, 0);
+    submit("interactive", HttpPriority::Interactive, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(client.getQueuedRequestCount(), 3u);
+    dropped->cancel();
+
+    for (int i = 0; i < 100; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (finished.size() == 5) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::vector<std::string> expected = {"interactive", "dropped failed", "blocker", "normal", "prefetch"};
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(finished, expected);
+}
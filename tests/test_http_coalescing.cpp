@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fake_http_client.hpp"
+#include "platform/http_coalescing.hpp"
+
+// Polls until `condition` holds or a generous timeout passes
+template <typename Condition>
+static bool waitFor(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(CoalescingHttpClientTest, ConcurrentCallersShareOneTransfer) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    FakeHttpClient inner([released](const HttpRequest&) {
+        released.wait();
+        return makeResponse("shared");
+    });
+    CoalescingHttpClient client(inner);
+    const std::string key = CoalescingHttpClient::makeKey("http://example.com/a", {}, {});
+
+    // Spelled differently, but the same request once normalized
+    std::vector<std::future<HttpResponse>> callers;
+    callers.push_back(std::async(std::launch::async, [&client]() {
+        return client.get("http://example.com/a", {}, {});
+    }));
+    ASSERT_TRUE(waitFor([&client, &key]() { return client.getWaiterCounts().count(key) == 1; }));
+    for (int i = 0; i < 3; i++) {
+        callers.push_back(std::async(std::launch::async, [&client]() {
+            return client.get("HTTP://Example.COM:80/a", {}, {});
+        }));
+    }
+    ASSERT_TRUE(waitFor([&client, &key]() { return client.getWaiterCounts()[key] == 3; }));
+
+    release.set_value();
+    for (auto& caller : callers) {
+        EXPECT_EQ(caller.get().text, "shared");
+    }
+    EXPECT_EQ(inner.getCallCount(), 1);
+    EXPECT_TRUE(client.getWaiterCounts().empty());
+    HttpCoalescingStats stats = client.getStats();
+    EXPECT_EQ(stats.transfers, 1u);
+    EXPECT_EQ(stats.coalesced, 3u);
+    EXPECT_EQ(stats.maxWaiters, 3u);
+
+    // Once the flight has landed, the next call is a transfer of its own
+    client.get("http://example.com/a", {}, {});
+    EXPECT_EQ(inner.getCallCount(), 2);
+}
+
+TEST(CoalescingHttpClientTest, JoinedCallersGetTheSameException) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    FakeHttpClient inner([released](const HttpRequest&) -> HttpResponse {
+        released.wait();
+        throw std::runtime_error("connection refused");
+    });
+    CoalescingHttpClient client(inner);
+    const std::string key = CoalescingHttpClient::makeKey("http://example.com/b", {}, {});
+
+    auto first = std::async(std::launch::async, [&client]() { return client.get("http://example.com/b", {}, {}); });
+    ASSERT_TRUE(waitFor([&client, &key]() { return client.getWaiterCounts().count(key) == 1; }));
+    auto joined = std::async(std::launch::async, [&client]() { return client.get("http://example.com/b", {}, {}); });
+    ASSERT_TRUE(waitFor([&client, &key]() { return client.getWaiterCounts()[key] == 1; }));
+
+    release.set_value();
+    EXPECT_THROW(first.get(), std::runtime_error);
+    EXPECT_THROW(joined.get(), std::runtime_error);
+    EXPECT_EQ(inner.getCallCount(), 1);
+    EXPECT_TRUE(client.getWaiterCounts().empty());
+}
+
+TEST(CoalescingHttpClientTest, KeysIgnoreSpellingButNotContent) {
+    EXPECT_EQ(CoalescingHttpClient::makeKey("HTTPS://API.example.com:443/v1/items?x=1", {{"a", "1"}}, {{"Accept", "json"}}),
+              CoalescingHttpClient::makeKey("https://api.example.com/v1/items?x=1", {{"a", "1"}}, {{"accept", "json"}}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/v1/items", {}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/v1/Items", {}, {}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com:8443/", {}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {}, {}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "1"}}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "2"}}, {}));
+    // Separators inside names and values are escaped
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/", {{"a=b", "c"}}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "b=c"}}, {}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "1\nb=2"}}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "1"}, {"b", "2"}}, {}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/", {}, {{"x", "1\ny:2"}}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {}, {{"x", "1"}, {"y", "2"}}));
+    EXPECT_NE(CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "%0A"}}, {}),
+              CoalescingHttpClient::makeKey("https://api.example.com/", {{"a", "\n"}}, {}));
+}
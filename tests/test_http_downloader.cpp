@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_downloader.hpp"
+#include "platform/state_manager.h"
+
+static std::string sha256Hex(const std::string& data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr);
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned int i = 0; i < length; ++i) {
+        hex.push_back(digits[digest[i] >> 4]);
+        hex.push_back(digits[digest[i] & 0x0f]);
+    }
+    return hex;
+}
+
+static std::string readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+class HttpDownloaderTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_downloader_test";
+        std::filesystem::create_directories(dir);
+        StateManager::getInstance().setInternalDataPath(dir.string());
+    }
+
+    void SetUp() override {
+        std::mt19937 rng(42);
+        m_blob.resize(1024 * 1024);
+        for (char& c : m_blob) {
+            c = static_cast<char>(rng());
+        }
+        m_dir = std::filesystem::temp_directory_path() / "http_downloader_test";
+        m_target = m_dir / "blob.bin";
+        std::filesystem::remove(m_target);
+        std::filesystem::remove(m_target.string() + ".part");
+        std::filesystem::remove(m_target.string() + ".part.json");
+
+        m_server.setHandler([this](const LoopbackRequest& request, LoopbackResponse& response) {
+            if (m_sendValidator) {
+                response.headers["ETag"] = "\"blob-v1\"";
+            }
+            if (m_rangesSupported) {
+                response.headers["Accept-Ranges"] = "bytes";
+            }
+            auto range = request.headers.find("range");
+            if (!m_rangesSupported || m_ignoreRanges || range == request.headers.end()) {
+                response.body = m_blob;
+                return;
+            }
+            size_t first = 0;
+            size_t last = 0;
+            if (std::sscanf(range->second.c_str(), "bytes=%zu-%zu", &first, &last) != 2 || last >= m_blob.size()) {
+                response.status = 416;
+                return;
+            }
+            if (first >= m_failFrom) {
+                response.status = 500;
+                return;
+            }
+            response.status = 206;
+            response.headers["Content-Range"] = "bytes " + std::to_string(first) + "-" + std::to_string(last)
+                + "/" + std::to_string(m_blob.size());
+            response.body = m_blob.substr(first, last - first + 1);
+        });
+    }
+
+    std::string m_blob;
+    std::filesystem::path m_dir;
+    std::filesystem::path m_target;
+    std::atomic<bool> m_rangesSupported{true};
+    std::atomic<size_t> m_failFrom{SIZE_MAX};
+    std::atomic<bool> m_ignoreRanges{false}; // Advertises ranges but answers 200 with the whole blob
+    std::atomic<bool> m_sendValidator{true};
+    LoopbackHttpServer m_server;
+    HttpClient m_client;
+};
+
+TEST_F(HttpDownloaderTest, FetchesSegmentsInParallelAndVerifiesChecksum) {
+    HttpDownloader downloader(m_client);
+    HttpDownloadOptions options;
+    options.segmentSize = 64 * 1024;
+    options.expectedSha256 = sha256Hex(m_blob);
+    HttpDownloadResult result = downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options);
+
+    EXPECT_TRUE(result.ranged);
+    EXPECT_EQ(result.length, m_blob.size());
+    EXPECT_EQ(result.segments, 16u);
+    EXPECT_EQ(result.sha256, options.expectedSha256);
+    EXPECT_EQ(readFile(m_target), m_blob);
+    EXPECT_FALSE(std::filesystem::exists(m_target.string() + ".part"));
+    EXPECT_FALSE(std::filesystem::exists(m_target.string() + ".part.json"));
+}
+
+TEST_F(HttpDownloaderTest, ResumesFromCompletedSegments) {
+    HttpDownloader downloader(m_client);
+    HttpDownloadOptions options;
+    options.segmentSize = 128 * 1024;
+    options.maxAttempts = 1;
+    m_failFrom = m_blob.size() / 2;
+    EXPECT_THROW(downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options), std::runtime_error);
+    EXPECT_TRUE(std::filesystem::exists(m_target.string() + ".part.json"));
+
+    m_failFrom = SIZE_MAX;
+    HttpDownloadResult result = downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options);
+    EXPECT_EQ(result.resumedBytes, m_blob.size() / 2);
+    EXPECT_EQ(result.segments, 4u);
+    EXPECT_EQ(readFile(m_target), m_blob);
+}
+
+TEST_F(HttpDownloaderTest, DiscardsDataThatFailsVerification) {
+    HttpDownloader downloader(m_client);
+    HttpDownloadOptions options;
+    options.expectedSha256 = std::string(64, '0');
+    EXPECT_THROW(downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options), std::runtime_error);
+    EXPECT_FALSE(std::filesystem::exists(m_target));
+    EXPECT_FALSE(std::filesystem::exists(m_target.string() + ".part"));
+    EXPECT_FALSE(std::filesystem::exists(m_target.string() + ".part.json"));
+}
+
+TEST_F(HttpDownloaderTest, StreamsWhenRangesAreNotSupported) {
+    m_rangesSupported = false;
+    HttpDownloader downloader(m_client);
+    HttpDownloadResult result = downloader.download(m_server.baseUrl() + "/blob", m_target.string());
+    EXPECT_FALSE(result.ranged);
+    EXPECT_EQ(result.length, m_blob.size());
+    EXPECT_EQ(readFile(m_target), m_blob);
+}
+
+TEST_F(HttpDownloaderTest, WritesNothingForSegmentsAnsweredWith200) {
+    HttpDownloader downloader(m_client);
+    HttpDownloadOptions options;
+    options.segmentSize = 64 * 1024;
+    // Served with If-Range, a 200 means the resource changed
+    m_ignoreRanges = true;
+    EXPECT_THROW(downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options), std::runtime_error);
+    const std::string part = readFile(m_target.string() + ".part");
+    ASSERT_EQ(part.size(), m_blob.size());
+    EXPECT_EQ(part.find_first_not_of('\0'), std::string::npos);
+}
+
+TEST_F(HttpDownloaderTest, StreamsWhenRangesAreIgnoredWithoutAValidator) {
+    m_ignoreRanges = true;
+    m_sendValidator = false;
+    HttpDownloader downloader(m_client);
+    HttpDownloadOptions options;
+    options.segmentSize = 64 * 1024;
+    HttpDownloadResult result = downloader.download(m_server.baseUrl() + "/blob", m_target.string(), options);
+    EXPECT_FALSE(result.ranged);
+    EXPECT_EQ(result.length, m_blob.size());
+    EXPECT_EQ(readFile(m_target), m_blob);
+}
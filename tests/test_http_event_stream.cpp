@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_event_stream.hpp"
+#include "platform/state_manager.h"
+
+static std::vector<HttpStreamEvent> parseAll(HttpEventStreamFormat format, const std::vector<std::string>& chunks) {
+    std::vector<HttpStreamEvent> events;
+    HttpEventStreamParser parser(format, [&](HttpStreamEvent&& event) { events.push_back(std::move(event)); });
+    for (const std::string& chunk : chunks) {
+        parser.write(chunk);
+    }
+    return events;
+}
+
+static const char* kStream =
+    "\xEF\xBB\xBF: heartbeat\r\n"
+    "retry: 250\r\n"
+    "id: 7\n"
+    "data: first\r"
+    "\r\n"
+    "event: update\n"
+    "data:second\n"
+    "data:  indented\n"
+    "unknown: field\n"
+    "\n"
+    "event: ignored-without-data\n"
+    "id\n"
+    "\n"
+    "data\n"
+    "\n";
+
+TEST(HttpEventStreamParserTest, ParsesSseAtEverySplitPoint) {
+    const std::string stream = kStream;
+    for (size_t split = 0; split <= stream.size(); ++split) {
+        std::vector<HttpStreamEvent> events = parseAll(HttpEventStreamFormat::ServerSentEvents,
+                                                       {stream.substr(0, split), stream.substr(split)});
+        ASSERT_EQ(events.size(), 3u) << "split at " << split;
+        EXPECT_EQ(events[0].type, "message");
+        EXPECT_EQ(events[0].data, "first");
+        EXPECT_EQ(events[0].id, "7");
+        EXPECT_EQ(events[1].type, "update");
+        EXPECT_EQ(events[1].data, "second\n indented");
+        EXPECT_EQ(events[1].id, "7");
+        EXPECT_EQ(events[2].data, "");
+        EXPECT_EQ(events[2].id, "") << "an empty id field resets the last event ID";
+    }
+}
+
+TEST(HttpEventStreamParserTest, KeepsIdAndRetryAcrossReset) {
+    HttpEventStreamParser parser(HttpEventStreamFormat::ServerSentEvents, [](HttpStreamEvent&&) {});
+    parser.write("retry: 1500\nretry: soon\nretry: 99999999999999999999\nid: 42\ndata: partial");
+    parser.reset();
+    EXPECT_EQ(parser.getLastEventId(), "42");
+    EXPECT_EQ(parser.getRetryDelay(), std::chrono::milliseconds(1500));
+
+    std::vector<HttpStreamEvent> events;
+    HttpEventStreamParser fresh(HttpEventStreamFormat::ServerSentEvents,
+                                [&](HttpStreamEvent&& event) { events.push_back(std::move(event)); });
+    fresh.write("data: lost");
+    fresh.reset();
+    fresh.write("\ndata: kept\n\n");
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].data, "kept");
+}
+
+TEST(HttpEventStreamParserTest, ParsesNdJsonLines) {
+    std::vector<HttpStreamEvent> events = parseAll(HttpEventStreamFormat::NdJson,
+                                                   {"{\"n\":1}\r\n\n[2,", "3]\nnot json\n\"four\"", "\n"});
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[0].json["n"], 1);
+    EXPECT_EQ(events[1].json, nlohmann::json({2, 3}));
+    EXPECT_EQ(events[1].data, "[2,3]");
+    EXPECT_EQ(events[2].json, "four");
+}
+
+TEST(HttpEventSubscriptionTest, ReconnectsWithLastEventIdUntilNoContent) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_event_stream_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    std::mutex mutex;
+    std::vector<std::string> lastIds;
+    LoopbackHttpServer server;
+    server.setHandler([&](const LoopbackRequest& request, LoopbackResponse& response) {
+        auto header = request.headers.find("last-event-id");
+        std::string lastId = header == request.headers.end() ? "" : header->second;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastIds.push_back(lastId);
+        }
+        response.headers["Content-Type"] = "text/event-stream";
+        response.chunkSize = 5;
+        if (lastId.empty()) {
+            response.body = "retry: 20\n\nid: 1\ndata: a\n\n: ping\nid: 2\nevent: tick\ndata: b\ndata: c\n\n";
+        } else if (lastId == "2") {
+            response.body = "id: 3\ndata: d\n\n";
+        } else {
+            response.status = 204;
+        }
+    });
+
+    HttpClient client;
+    std::vector<HttpStreamEvent> received;
+    size_t batches = 0;
+    HttpEventStreamOptions options;
+    options.reconnectDelay = std::chrono::milliseconds(1000);
+    HttpEventSubscription subscription(client, server.baseUrl() + "/events",
+        [&](std::vector<HttpStreamEvent>&& events) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches++;
+            for (HttpStreamEvent& event : events) {
+                received.push_back(std::move(event));
+            }
+        }, options);
+
+    // The server's retry: 20 replaces the one second default, so this finishes quickly
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!subscription.isClosed() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(subscription.isClosed());
+    subscription.close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(lastIds, (std::vector<std::string>{"", "2", "3"}));
+    ASSERT_EQ(received.size(), 3u);
+    EXPECT_EQ(received[0].data, "a");
+    EXPECT_EQ(received[1].type, "tick");
+    EXPECT_EQ(received[1].data, "b\nc");
+    EXPECT_EQ(received[2].id, "3");
+    EXPECT_GE(batches, 1u);
+    EXPECT_EQ(subscription.getEventCount(), 3u);
+    EXPECT_EQ(subscription.getReconnectCount(), 2u);
+    EXPECT_EQ(subscription.getLastEventId(), "3");
+}
+
+TEST(HttpEventSubscriptionTest, ErrorAndWrongTypeBodiesAreNotParsed) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_event_stream_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server;
+    server.setHandler([](const LoopbackRequest& request, LoopbackResponse& response) {
+        if (request.path == "/ndjson") {
+            // A valid NDJSON line, which must not pass for an event
+            response.status = 500;
+            response.headers["Content-Type"] = "application/json";
+            response.body = "{\"error\":\"overloaded\"}\n";
+        } else {
+            response.headers["Content-Type"] = "text/html";
+            response.body = "data: not an event\n\n";
+        }
+    });
+
+    HttpClient client;
+    auto subscribe = [&](const std::string& path, HttpEventStreamFormat format) {
+        std::mutex mutex;
+        std::vector<std::string> errors;
+        std::atomic<int> received{0};
+        HttpEventStreamOptions options;
+        options.format = format;
+        options.reconnectDelay = std::chrono::seconds(10);
+        HttpEventSubscription subscription(client, server.baseUrl() + path,
+            [&](std::vector<HttpStreamEvent>&& events) { received += static_cast<int>(events.size()); },
+            options,
+            [&](const std::string& error) {
+                std::lock_guard<std::mutex> lock(mutex);
+                errors.push_back(error);
+            });
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!errors.empty()) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        subscription.close();
+        EXPECT_EQ(received.load(), 0) << path;
+        EXPECT_EQ(subscription.getEventCount(), 0u) << path;
+        std::lock_guard<std::mutex> lock(mutex);
+        return errors.empty() ? std::string() : errors.front();
+    };
+
+    EXPECT_EQ(subscribe("/ndjson", HttpEventStreamFormat::NdJson), "HTTP status 500");
+    EXPECT_EQ(subscribe("/html", HttpEventStreamFormat::ServerSentEvents), "Unexpected Content-Type \"text/html\"");
+}
+
+TEST(HttpEventSubscriptionTest, CloseAbortsAnOpenStream) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_event_stream_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server;
+    server.setHandler([](const LoopbackRequest&, LoopbackResponse& response) {
+        response.headers["Content-Type"] = "text/event-stream";
+        response.body = "data: hello\n\n" + std::string(40, ':') + "\n";
+        response.chunkSize = 13;
+        response.chunkDelay = std::chrono::milliseconds(100);
+    });
+
+    HttpClient client;
+    std::atomic<int> received{0};
+    HttpEventSubscription subscription(client, server.baseUrl() + "/events",
+        [&](std::vector<HttpStreamEvent>&& events) { received += static_cast<int>(events.size()); });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (received == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(received.load(), 1);
+    EXPECT_TRUE(subscription.isConnected());
+
+    auto start = std::chrono::steady_clock::now();
+    subscription.close();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_TRUE(subscription.isClosed());
+    EXPECT_FALSE(subscription.isConnected());
+}
+
+TEST(HttpEventSubscriptionTest, HandlerCanReadLastEventIdInline) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_event_stream_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server;
+    server.setHandler([](const LoopbackRequest&, LoopbackResponse& response) {
+        response.headers["Content-Type"] = "text/event-stream";
+        response.body = "id: 1\ndata: a\n\nid: 2\ndata: b\n\n" + std::string(40, ':') + "\n";
+        response.delay = std::chrono::milliseconds(100); // Lets the test publish the subscription first
+        response.chunkSize = 8;
+    });
+
+    // Without a main-thread dispatcher onEvents runs on the I/O thread, inside the body sink
+    HttpClient client;
+    std::atomic<HttpEventSubscription*> current{nullptr};
+    std::mutex mutex;
+    std::vector<std::string> ids;
+    HttpEventSubscription subscription(client, server.baseUrl() + "/events",
+        [&](std::vector<HttpStreamEvent>&&) {
+            if (HttpEventSubscription* self = current.load()) {
+                std::string id = self->getLastEventId();
+                std::lock_guard<std::mutex> lock(mutex);
+                ids.push_back(id);
+            }
+        });
+    current = &subscription;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (subscription.getEventCount() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    subscription.close();
+    EXPECT_EQ(subscription.getEventCount(), 2u);
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_FALSE(ids.empty());
+    EXPECT_EQ(ids.back(), "2");
+}
+
+TEST(HttpEventSubscriptionTest, HandlersCanCloseWithoutADispatcher) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_event_stream_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server;
+    server.setHandler([](const LoopbackRequest& request, LoopbackResponse& response) {
+        response.delay = std::chrono::milliseconds(100); // Lets the test publish the subscriptions first
+        if (request.path == "/broken") {
+            response.status = 500;
+            return;
+        }
+        response.headers["Content-Type"] = "text/event-stream";
+        response.body = "data: hello\n\n" + std::string(40, ':') + "\n";
+        response.chunkSize = 13;
+        response.chunkDelay = std::chrono::milliseconds(100);
+    });
+
+    // onEvents runs on the I/O thread and onError on the subscription's own thread
+    HttpClient client;
+    std::atomic<HttpEventSubscription*> current{nullptr};
+    HttpEventStreamOptions options;
+    options.reconnectDelay = std::chrono::milliseconds(20);
+    HttpEventSubscription events(client, server.baseUrl() + "/events",
+        [&](std::vector<HttpStreamEvent>&&) {
+            if (HttpEventSubscription* self = current.load()) {
+                self->close();
+            }
+        },
+        options);
+    current = &events;
+    HttpEventSubscription errors(client, server.baseUrl() + "/broken",
+        [](std::vector<HttpStreamEvent>&&) {},
+        options,
+        [&](const std::string&) { errors.close(); });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!events.isClosed() || !errors.isClosed()) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(events.isClosed());
+    EXPECT_TRUE(errors.isClosed());
+    EXPECT_EQ(errors.getReconnectCount(), 0u);
+    // The stream is still sending; the request must end without waiting for it
+    auto start = std::chrono::steady_clock::now();
+    events.close();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_EQ(events.getEventCount(), 1u);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "platform/http_latency.hpp"
+
+using std::chrono::microseconds;
+
+static HttpLatencyHistogram histogramOf(std::initializer_list<int64_t> values) {
+    HttpLatencyHistogram histogram;
+    for (int64_t value : values) {
+        histogram.record(microseconds(value));
+    }
+    return histogram;
+}
+
+TEST(HttpLatencyHistogramTest, IsExactBelowTheLinearLimit) {
+    HttpLatencyHistogram histogram;
+    for (int i = 1; i <= 31; i++) {
+        histogram.record(microseconds(i));
+    }
+    EXPECT_EQ(histogram.getCount(), 31u);
+    EXPECT_EQ(histogram.getMin(), microseconds(1));
+    EXPECT_EQ(histogram.getMax(), microseconds(31));
+    EXPECT_DOUBLE_EQ(histogram.getMeanMicros(), 16.0);
+    EXPECT_EQ(histogram.percentile(0.0), microseconds(1));
+    EXPECT_EQ(histogram.percentile(0.5), microseconds(16)); // Rank 16 of 31
+    EXPECT_EQ(histogram.percentile(0.9), microseconds(28));
+    EXPECT_EQ(histogram.percentile(1.0), microseconds(31));
+}
+
+TEST(HttpLatencyHistogramTest, ReportsBucketUpperBoundsAtTheEdges) {
+    // 31 is the last exact value; 32 and 33 share the first two-wide bucket
+    HttpLatencyHistogram low = histogramOf({31, 32, 33, 34});
+    EXPECT_EQ(low.percentile(0.25), microseconds(31));
+    EXPECT_EQ(low.percentile(0.5), microseconds(33));
+    EXPECT_EQ(low.percentile(0.75), microseconds(33));
+    // The top bucket reaches 35, but nothing above 34 was seen
+    EXPECT_EQ(low.percentile(1.0), microseconds(34));
+
+    // 63 closes the [32, 64) octave; 64 opens the next one, with four-wide buckets
+    HttpLatencyHistogram octave = histogramOf({63, 64, 65, 100});
+    EXPECT_EQ(octave.percentile(0.25), microseconds(63));
+    EXPECT_EQ(octave.percentile(0.5), microseconds(67));
+    EXPECT_EQ(octave.percentile(0.75), microseconds(67));
+    EXPECT_EQ(octave.percentile(0.9), microseconds(100)); // Bucket [96, 104), clamped to the max
+    EXPECT_EQ(octave.percentile(1.0), microseconds(100));
+}
+
+TEST(HttpLatencyHistogramTest, StaysWithinTheRelativeErrorBound) {
+    for (int64_t value = 32; value < 10000000; value = value * 5 / 4 + 1) {
+        // A second, larger sample keeps the max from hiding the bucket bound
+        HttpLatencyHistogram histogram = histogramOf({value, value * 2});
+        const int64_t reported = histogram.percentile(0.5).count();
+        EXPECT_GE(reported, value);
+        EXPECT_LE(static_cast<double>(reported - value), value / 16.0) << value;
+    }
+    // Far beyond the range: clamped into the last bucket, which reports the exact max
+    HttpLatencyHistogram huge = histogramOf({INT64_C(1) << 50, -5});
+    EXPECT_EQ(huge.getMin(), microseconds(0));
+    EXPECT_EQ(huge.percentile(1.0), microseconds(INT64_C(1) << 50));
+    EXPECT_EQ(HttpLatencyHistogram().percentile(0.5), microseconds(0));
+}
+
+TEST(HttpLatencyHistogramTest, MergesAndDumpsJson) {
+    HttpLatencyHistogram histogram = histogramOf({31, 32});
+    histogram.merge(histogramOf({33, 34}));
+    histogram.merge(HttpLatencyHistogram());
+
+    nlohmann::json json = histogram.toJson();
+    EXPECT_EQ(json["count"], 4);
+    EXPECT_EQ(json["min_us"], 31);
+    EXPECT_EQ(json["max_us"], 34);
+    EXPECT_DOUBLE_EQ(json["mean_us"].get<double>(), 32.5);
+    EXPECT_EQ(json["p50_us"], 33);
+    EXPECT_EQ(json["p99_us"], 34);
+    EXPECT_EQ(json["buckets"], nlohmann::json::parse("[[31, 1], [33, 2], [35, 1]]"));
+
+    histogram.clear();
+    EXPECT_EQ(histogram.toJson()["count"], 0);
+    EXPECT_EQ(histogram.toJson()["min_us"], 0);
+    EXPECT_TRUE(histogram.toJson()["buckets"].empty());
+}
+
+TEST(HttpLatencyTrackerTest, KeepsPerHostHistogramsForTheWindow) {
+    HttpLatencyTracker tracker(std::chrono::seconds(1), 4);
+    HttpTiming timing;
+    timing.start_transfer = microseconds(10);
+    timing.total = microseconds(20);
+    tracker.record("https://a.example.com:443", timing);
+    tracker.record("https://a.example.com:443", timing);
+    tracker.record("http://b.example.com:80", timing);
+
+    EXPECT_EQ(tracker.getHosts().size(), 2u);
+    EXPECT_EQ(tracker.getTotal("https://a.example.com:443").getCount(), 2u);
+    EXPECT_EQ(tracker.getTotal("https://a.example.com:443").getMax(), microseconds(20));
+    EXPECT_EQ(tracker.getTimeToFirstByte("https://a.example.com:443").getMax(), microseconds(10));
+    EXPECT_EQ(tracker.getTotal("http://unknown:80").getCount(), 0u);
+
+    nlohmann::json json = tracker.toJson();
+    EXPECT_EQ(json["https://a.example.com:443"]["total"]["count"], 2);
+    EXPECT_EQ(json["https://a.example.com:443"]["ttfb"]["p50_us"], 10);
+    EXPECT_EQ(json["http://b.example.com:80"]["total"]["p99_us"], 20);
+
+    // Once the window has passed, the old slots no longer count
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_EQ(tracker.getTotal("https://a.example.com:443").getCount(), 0u);
+    EXPECT_EQ(tracker.toJson()["http://b.example.com:80"]["total"]["count"], 0);
+}
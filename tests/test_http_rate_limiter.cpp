@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fake_http_client.hpp"
+#include "platform/http_rate_limiter.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+TEST(RateLimitingHttpClientTest, SpendsTheBurstThenWaitsForRefills) {
+    FakeHttpClient inner([](const HttpRequest&) { return makeResponse("ok"); });
+    HttpRateLimit limit;
+    limit.requestsPerSecond = 20.0; // One token every 50 ms
+    limit.burst = 3.0;
+    RateLimitingHttpClient client(inner, limit);
+
+    auto start = Clock::now();
+    for (int i = 0; i < 3; i++) {
+        client.get("http://example.com/a", {}, {});
+    }
+    EXPECT_LT(millisecondsSince(start), 40.0);
+    for (int i = 0; i < 2; i++) {
+        client.get("http://example.com/a", {}, {});
+    }
+    EXPECT_GE(millisecondsSince(start), 90.0);
+
+    // Other hosts have buckets of their own
+    start = Clock::now();
+    client.get("http://other.example.com/", {}, {});
+    EXPECT_LT(millisecondsSince(start), 40.0);
+
+    HttpHostLimiterStats stats = client.getStats().at("http://example.com:80");
+    EXPECT_EQ(stats.requests, 5u);
+    EXPECT_EQ(stats.queueDepth, 0u);
+    EXPECT_EQ(stats.active, 0u);
+    EXPECT_GE(stats.maxWaitMs, 40.0);
+}
+
+TEST(RateLimitingHttpClientTest, CapsConcurrentRequestsPerHost) {
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+    FakeHttpClient inner([&](const HttpRequest&) {
+        int now = ++active;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        active--;
+        return makeResponse("ok");
+    });
+    HttpRateLimit limit;
+    limit.requestsPerSecond = 1000.0;
+    limit.burst = 100.0;
+    limit.maxConcurrent = 2;
+    RateLimitingHttpClient client(inner, limit);
+
+    auto sendEight = [&client](const std::string& url) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; i++) {
+            threads.emplace_back([&client, url]() { client.get(url, {}, {}); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    };
+    sendEight("http://example.com/a");
+    EXPECT_EQ(inner.getCallCount(), 8);
+    EXPECT_EQ(peak.load(), 2);
+
+    // Zero lifts the cap rather than letting nothing through
+    limit.maxConcurrent = 0;
+    client.setHostLimit("http://uncapped.example.com/", limit);
+    peak = 0;
+    sendEight("http://uncapped.example.com/a");
+    EXPECT_EQ(inner.getCallCount(), 16);
+    EXPECT_GT(peak.load(), 2);
+}
+
+TEST(RateLimitingHttpClientTest, BacksOffAfterTooManyRequests) {
+    std::atomic<int> calls{0};
+    FakeHttpClient inner([&](const HttpRequest&) {
+        if (calls++ == 0) {
+            // Long enough that crediting the time in flight would refill the bucket
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            return makeResponse("slow down", {{"Retry-After", "1"}}, 429);
+        }
+        return makeResponse("ok");
+    });
+    HttpRateLimit limit;
+    limit.requestsPerSecond = 10.0;
+    limit.burst = 5.0;
+    RateLimitingHttpClient client(inner, limit);
+
+    EXPECT_EQ(client.get("http://example.com/a", {}, {}).status_code, 429);
+    HttpHostLimiterStats stats = client.getStats().at("http://example.com:80");
+    EXPECT_EQ(stats.throttled, 1u);
+    EXPECT_LT(stats.tokens, 1.0);
+    EXPECT_GT(stats.blockedFor.count(), 500);
+
+    auto start = Clock::now();
+    EXPECT_EQ(client.get("http://example.com/a", {}, {}).status_code, 200);
+    EXPECT_GE(millisecondsSince(start), 700.0);
+}
+
+TEST(RateLimitingHttpClientTest, CapsRetryAfterPauses) {
+    FakeHttpClient inner([](const HttpRequest&) {
+        return makeResponse("slow down", {{"Retry-After", "99999999999999999999"}}, 503);
+    });
+    HttpRateLimit limit;
+    limit.maxRetryAfter = std::chrono::seconds(2);
+    RateLimitingHttpClient client(inner, limit);
+
+    EXPECT_EQ(client.get("http://example.com/a", {}, {}).status_code, 503);
+    HttpHostLimiterStats stats = client.getStats().at("http://example.com:80");
+    EXPECT_GT(stats.blockedFor.count(), 1000);
+    EXPECT_LE(stats.blockedFor.count(), 2000);
+}
+
+TEST(ParseRetryAfterTest, ReadsBothFormsAndClamps) {
+    using std::chrono::seconds;
+    EXPECT_EQ(parseRetryAfter("120"), seconds(120));
+    EXPECT_EQ(parseRetryAfter("120", seconds(60)), seconds(60));
+    EXPECT_EQ(parseRetryAfter("99999999999999999999"), kMaxRetryAfter);
+    EXPECT_EQ(parseRetryAfter("Thu, 01 Jan 1970 00:00:01 GMT"), seconds(0)); // In the past
+    EXPECT_EQ(parseRetryAfter("Fri, 31 Dec 2100 23:59:59 GMT"), kMaxRetryAfter);
+    EXPECT_FALSE(parseRetryAfter("soon"));
+}
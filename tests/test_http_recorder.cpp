@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_recorder.hpp"
+#include "platform/state_manager.h"
+
+class HttpRecorderTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_recorder_test";
+        std::filesystem::create_directories(dir);
+        StateManager::getInstance().setInternalDataPath(dir.string());
+    }
+
+    void SetUp() override {
+        m_archive = (std::filesystem::temp_directory_path() / "http_recorder_test" / "session.httprec").string();
+        std::filesystem::remove(m_archive);
+    }
+
+    // Records a small session against a loopback server that is gone afterwards
+    void recordSession() {
+        LoopbackHttpServer server;
+        HttpClient client;
+        RecordingHttpClient recorder(client, m_archive);
+        m_bytes = recorder.get(server.baseUrl() + "/bytes", {{"size", "5000"}}, {{"Authorization", "Bearer 1"}});
+        recorder.get(server.baseUrl() + "/status", {{"code", "404"}}, {});
+        recorder.get(server.baseUrl() + "/bytes", {{"size", "10"}, {"delay_ms", "150"}}, {});
+
+        HttpRequest post;
+        post.method = "POST";
+        post.url = server.baseUrl() + "/echo";
+        post.body.data = "first";
+        recorder.request(post);
+        post.body.data = "second";
+        recorder.request(post);
+
+        HttpRequest streamed;
+        streamed.url = server.baseUrl() + "/bytes?size=40000";
+        streamed.sink = [](std::string_view) { return true; };
+        recorder.request(streamed);
+
+        HttpRequest dropped;
+        dropped.url = server.baseUrl() + "/drop";
+        HttpRetryPolicy once;
+        once.maxAttempts = 1;
+        dropped.retryPolicy = once;
+        EXPECT_THROW(recorder.request(dropped), std::runtime_error);
+        EXPECT_EQ(recorder.getRecordedCount(), 7u);
+        m_baseUrl = server.baseUrl();
+    }
+
+    std::string m_archive;
+    std::string m_baseUrl;
+    HttpResponse m_bytes;
+};
+
+TEST_F(HttpRecorderTest, ReplaysRecordedExchangesOffline) {
+    recordSession();
+    ReplayHttpClient replay(m_archive);
+    EXPECT_EQ(replay.getRecordingCount(), 7u);
+
+    // Headers are not part of the match
+    HttpResponse bytes = replay.get(m_baseUrl + "/bytes", {{"size", "5000"}}, {{"Authorization", "Bearer 2"}});
+    EXPECT_EQ(bytes.status_code, 200);
+    EXPECT_EQ(bytes.text, m_bytes.text);
+    EXPECT_EQ(bytes.headers, m_bytes.headers);
+    EXPECT_EQ(bytes.timing.total, m_bytes.timing.total);
+    EXPECT_EQ(replay.get(m_baseUrl + "/status", {{"code", "404"}}, {}).status_code, 404);
+
+    HttpRequest post;
+    post.method = "POST";
+    post.url = m_baseUrl + "/echo";
+    post.body.data = "second";
+    EXPECT_EQ(replay.request(post).text, "second");
+    post.body.data = "first";
+    EXPECT_EQ(replay.request(post).text, "first");
+
+    std::string streamed;
+    HttpRequest stream;
+    stream.url = m_baseUrl + "/bytes?size=40000";
+    stream.sink = [&](std::string_view chunk) {
+        streamed.append(chunk.data(), chunk.size());
+        return true;
+    };
+    HttpResponse response = replay.request(stream);
+    EXPECT_TRUE(response.text.empty());
+    EXPECT_EQ(streamed.size(), 40000u);
+
+    HttpRequest dropped;
+    dropped.url = m_baseUrl + "/drop";
+    EXPECT_THROW(replay.request(dropped), std::runtime_error);
+    EXPECT_THROW(replay.get(m_baseUrl + "/never", {}, {}), std::runtime_error);
+    EXPECT_EQ(replay.getMissCount(), 1u);
+}
+
+TEST_F(HttpRecorderTest, RecordedPacingReproducesLatency) {
+    recordSession();
+    ReplayHttpClient fast(m_archive);
+    ReplayHttpClient paced(m_archive, HttpReplayPacing::Recorded);
+    const std::map<std::string, std::string> slow = {{"size", "10"}, {"delay_ms", "150"}};
+
+    auto start = std::chrono::steady_clock::now();
+    fast.get(m_baseUrl + "/bytes", slow, {});
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    start = std::chrono::steady_clock::now();
+    HttpResponse response = paced.get(m_baseUrl + "/bytes", slow, {});
+    EXPECT_GE(std::chrono::steady_clock::now() - start, response.timing.total);
+    EXPECT_GE(response.timing.total, std::chrono::milliseconds(150));
+}
+
+TEST_F(HttpRecorderTest, RejectsDamagedArchives) {
+    EXPECT_THROW(ReplayHttpClient(m_archive + ".missing"), std::runtime_error);
+    recordSession();
+    std::filesystem::resize_file(m_archive, std::filesystem::file_size(m_archive) - 3);
+    EXPECT_THROW(ReplayHttpClient{m_archive}, std::runtime_error);
+    std::ofstream(m_archive, std::ios::binary | std::ios::trunc) << "not a recording";
+    EXPECT_THROW(ReplayHttpClient{m_archive}, std::runtime_error);
+}
+
+TEST(HttpRecorderKeyTest, IdentifiesBodiesByAStableDigest) {
+    HttpRequest request;
+    request.method = "POST";
+    request.url = "HTTP://Example.com:80/submit";
+    request.params = {{"v", "1"}};
+    request.body.data = "abc";
+    // The same on every platform and build, so archives can be replayed anywhere
+    EXPECT_EQ(ReplayHttpClient::makeKey(request),
+              "POST http://example.com/submit\nv=1\n"
+              "\nbody:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    HttpRequest form;
+    form.method = "POST";
+    form.url = "http://example.com/upload";
+    HttpFormPart part;
+    part.name = "file";
+    part.data = "abc";
+    form.form.push_back(part);
+    EXPECT_NE(ReplayHttpClient::makeKey(form).find("\nform:file:ba7816bf"), std::string::npos);
+
+    // Uploads are keyed by what the file holds, not where it is
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "http_recorder_key_upload.txt";
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "abc";
+    HttpRequest upload;
+    upload.method = "PUT";
+    upload.url = "http://example.com/upload";
+    upload.body.filePath = path.string();
+    const std::string before = ReplayHttpClient::makeKey(upload);
+    EXPECT_NE(before.find("\nbody:ba7816bf"), std::string::npos);
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "abd";
+    EXPECT_NE(ReplayHttpClient::makeKey(upload), before);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <curl/curl.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "http_test_server.hpp"
+#include "platform/http_share.hpp"
+
+class HttpShareTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_share_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        m_file = (dir / "tls_sessions.json").string();
+    }
+
+    void writeFile(const std::string& text) {
+        std::ofstream(m_file, std::ios::trunc) << text;
+    }
+
+    std::string readFile() {
+        std::ifstream file(m_file);
+        std::ostringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    void expectOwnerOnly() {
+#ifndef _WIN32
+        using std::filesystem::perms;
+        perms permissions = std::filesystem::status(m_file).permissions();
+        EXPECT_EQ(permissions & (perms::group_all | perms::others_all), perms::none);
+        EXPECT_NE(permissions & perms::owner_read, perms::none);
+#endif
+    }
+
+    std::string m_file;
+};
+
+static size_t discard(char*, size_t size, size_t count, void*) {
+    return size * count;
+}
+
+// One TLS request through the share, which leaves a session in its cache
+static CURLcode fetchOverTls(HttpShare& share, const LoopbackHttpServer& server) {
+    CURL* handle = curl_easy_init();
+    const std::string url = server.baseUrl() + "/bytes?size=10";
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_SHARE, share.handle());
+    curl_blob certificate{const_cast<char*>(server.certificatePem().data()), server.certificatePem().size(),
+                          CURL_BLOB_COPY};
+    curl_easy_setopt(handle, CURLOPT_CAINFO_BLOB, &certificate);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, discard);
+    CURLcode result = curl_easy_perform(handle);
+    curl_easy_cleanup(handle);
+    return result;
+}
+
+TEST_F(HttpShareTest, SavesNothingWithoutSessions) {
+    HttpShare share(m_file);
+    EXPECT_EQ(share.loadTlsSessions(), 0u);
+    EXPECT_EQ(share.saveTlsSessions(), 0u);
+    // Builds without session export (CURLE_NOT_BUILT_IN) write no file at all
+    if (std::filesystem::exists(m_file)) {
+        EXPECT_EQ(readFile(), "[]");
+        expectOwnerOnly();
+    }
+    EXPECT_EQ(share.loadTlsSessions(), 0u);
+    EXPECT_FALSE(std::filesystem::exists(m_file + ".tmp"));
+}
+
+TEST_F(HttpShareTest, IgnoresDamagedAndExpiredSessions) {
+    HttpShare share(m_file);
+    writeFile("not json");
+    EXPECT_EQ(share.loadTlsSessions(), 0u);
+    writeFile("{\"shmac\": \"00\"}");
+    EXPECT_EQ(share.loadTlsSessions(), 0u);
+    writeFile("[{\"shmac\": \"zz\", \"data\": \"0\"}, {\"shmac\": \"00\", \"data\": \"00\", \"valid_until\": 1}]");
+    EXPECT_EQ(share.loadTlsSessions(), 0u);
+}
+
+TEST_F(HttpShareTest, RoundTripsSessionsThroughTheFile) {
+    LoopbackHttpServer server(true);
+    size_t saved = 0;
+    {
+        HttpShare share(m_file);
+        ASSERT_EQ(fetchOverTls(share, server), CURLE_OK);
+        saved = share.saveTlsSessions();
+    }
+    if (saved == 0) {
+        GTEST_SKIP() << "libcurl " << curl_version_info(CURLVERSION_NOW)->version
+                     << " can't export TLS sessions";
+    }
+    expectOwnerOnly();
+    EXPECT_EQ(readFile().find("127.0.0.1"), std::string::npos) << "host names are not stored";
+
+    HttpShare restored(m_file);
+    EXPECT_EQ(restored.loadTlsSessions(), saved);
+    EXPECT_GE(restored.saveTlsSessions(), saved);
+}
@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_sinks.hpp"
+#include "platform/state_manager.h"
+
+// Records SAX events as text so two event streams can be compared
+class RecordingSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+    bool null() override { return add("null"); }
+    bool boolean(bool value) override { return add(value ? "true" : "false"); }
+    bool number_integer(number_integer_t value) override { return add("int:" + std::to_string(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return add("uint:" + std::to_string(value)); }
+    bool number_float(number_float_t, const string_t& text) override { return add("float:" + text); }
+    bool string(string_t& value) override { return add("string:" + value); }
+    bool binary(binary_t&) override { return add("binary"); }
+    bool start_object(std::size_t) override { return add("{"); }
+    bool key(string_t& value) override { return add("key:" + value); }
+    bool end_object() override { return add("}"); }
+    bool start_array(std::size_t) override { return add("["); }
+    bool end_array() override { return add("]"); }
+    bool parse_error(std::size_t, const std::string&, const nlohmann::json::exception&) override {
+        errors++;
+        return false;
+    }
+
+    bool add(const std::string& event) {
+        events.push_back(event);
+        return stopAfter == 0 || events.size() < stopAfter;
+    }
+
+    std::vector<std::string> events;
+    size_t errors = 0;
+    size_t stopAfter = 0;
+};
+
+static const char* kDocument =
+    R"({"name":"caf\u00e9 \ud83d\ude00","escaped":"a\"b\\c\/d\n","numbers":[0,-12,18446744073709551615,)"
+    R"(-9223372036854775808,3.25,-1e-3,2E+10,123456789012345678901234567890],)"
+    R"("flags":[true,false,null],"nested":{"empty":{},"list":[[],[{}]]}})";
+
+static std::vector<std::string> referenceEvents(const std::string& text) {
+    RecordingSax sax;
+    nlohmann::json::sax_parse(text, &sax);
+    return sax.events;
+}
+
+TEST(HttpJsonSaxSinkTest, MatchesNlohmannForEverySplitPoint) {
+    const std::string document = kDocument;
+    const std::vector<std::string> expected = referenceEvents(document);
+    ASSERT_EQ(expected.size(), 38u);
+    for (size_t split = 0; split <= document.size(); ++split) {
+        RecordingSax sax;
+        HttpJsonSaxSink sink(sax);
+        ASSERT_TRUE(sink.write(std::string_view(document).substr(0, split)));
+        ASSERT_TRUE(sink.write(std::string_view(document).substr(split)));
+        ASSERT_TRUE(sink.finish()) << sink.getError();
+        ASSERT_EQ(sax.events, expected) << "split at " << split;
+    }
+}
+
+TEST(HttpJsonSaxSinkTest, DeliversConsecutiveTopLevelValues) {
+    RecordingSax sax;
+    HttpJsonSaxSink sink(sax);
+    ASSERT_TRUE(sink.write("{\"a\":1}\n[2]\n\"three\"\n4"));
+    ASSERT_TRUE(sink.finish());
+    EXPECT_EQ(sink.getValueCount(), 4u);
+    std::vector<std::string> expected = {"{", "key:a", "uint:1", "}", "[", "uint:2", "]", "string:three", "uint:4"};
+    EXPECT_EQ(sax.events, expected);
+}
+
+TEST(HttpJsonSaxSinkTest, ReportsSyntaxErrors) {
+    const char* invalid[] = {"{\"a\" 1}", "[1,]", "[01]", "tru", "{\"a\":1", "\"unterminated", "[1 2]", "}",
+                             "\"\\x\"", "\"\\ud83d\"", "-", "1.e5"};
+    for (const char* text : invalid) {
+        RecordingSax sax;
+        HttpJsonSaxSink sink(sax);
+        bool ok = sink.write(text) && sink.finish();
+        EXPECT_FALSE(ok) << text;
+        EXPECT_EQ(sax.errors, 1u) << text;
+        EXPECT_FALSE(sink.getError().empty()) << text;
+    }
+}
+
+TEST(HttpJsonSaxSinkTest, HandlerCanStopTheTransfer) {
+    RecordingSax sax;
+    sax.stopAfter = 3;
+    HttpJsonSaxSink sink(sax);
+    EXPECT_FALSE(sink.write("[1,2,3,4,5]"));
+    EXPECT_EQ(sax.events.size(), 3u);
+    EXPECT_EQ(sax.errors, 0u);
+    EXPECT_FALSE(sink.write("6"));
+}
+
+TEST(HttpJsonSaxSinkTest, DecodesWhileTheBodyStreams) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_sinks_test";
+    std::filesystem::create_directories(dir);
+    StateManager::getInstance().setInternalDataPath(dir.string());
+
+    LoopbackHttpServer server;
+    server.setHandler([](const LoopbackRequest&, LoopbackResponse& response) {
+        response.headers["Content-Type"] = "application/json";
+        response.body = kDocument;
+        response.chunkSize = 7;
+    });
+    HttpClient client;
+    RecordingSax sax;
+    HttpJsonSaxSink sink(sax);
+    HttpResponse response = client.getStream(server.baseUrl() + "/doc", {}, {}, sink.sink());
+    ASSERT_TRUE(sink.finish()) << sink.getError();
+    EXPECT_TRUE(response.text.empty());
+    EXPECT_EQ(sax.events, referenceEvents(kDocument));
+}
+
+TEST(HttpFileSinkTest, WritesChunksUntilClosed) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_sinks_test";
+    std::filesystem::create_directories(dir);
+    const std::string path = (dir / "body.bin").string();
+
+    HttpFileSink sink(path);
+    HttpChunkSink write = sink.sink();
+    EXPECT_TRUE(write("hello, "));
+    EXPECT_TRUE(write(std::string_view("wor\0ld", 6)));
+    EXPECT_EQ(sink.getBytesWritten(), 13u);
+    EXPECT_TRUE(sink.close());
+    EXPECT_FALSE(sink.write("late"));
+
+    std::ifstream file(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, std::string("hello, wor\0ld", 13));
+
+    EXPECT_THROW(HttpFileSink((dir / "missing" / "body.bin").string()), std::runtime_error);
+}
+
+TEST(HttpRingBufferSinkTest, WrapsAroundAndBlocksTheWriterWhenFull) {
+    // 7 bytes, written in 5s and read in 3s, so copies keep straddling the end of the ring
+    HttpRingBufferSink ring(7);
+    std::string body;
+    for (int i = 0; i < 1000; i++) {
+        body += static_cast<char>('a' + i % 26);
+    }
+    std::atomic<size_t> written{0};
+    std::thread writer([&]() {
+        for (size_t offset = 0; offset < body.size(); offset += 5) {
+            EXPECT_TRUE(ring.write(std::string_view(body).substr(offset, 5)));
+            written = std::min(offset + 5, body.size());
+        }
+        ring.finish();
+    });
+
+    // Nobody reads yet: the writer gets one chunk in, then stalls inside the second
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(written.load(), 5u);
+
+    std::string received;
+    char buffer[3];
+    while (size_t count = ring.read(buffer, sizeof(buffer))) {
+        received.append(buffer, count);
+    }
+    writer.join();
+    EXPECT_EQ(received, body);
+    EXPECT_EQ(ring.read(buffer, sizeof(buffer)), 0u);
+}
+
+TEST(HttpRingBufferSinkTest, CancelWakesBlockedWriterAndReader) {
+    HttpRingBufferSink ring(4);
+    std::atomic<bool> writerDone{false};
+    std::thread writer([&]() {
+        EXPECT_FALSE(ring.write("more than four bytes"));
+        writerDone = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(writerDone.load());
+
+    char buffer[16];
+    HttpRingBufferSink empty(4);
+    std::thread reader([&]() { EXPECT_EQ(empty.read(buffer, sizeof(buffer)), 0u); });
+
+    ring.cancel();
+    empty.cancel();
+    writer.join();
+    reader.join();
+    EXPECT_TRUE(writerDone.load());
+    // Whatever was still buffered is dropped, and later writes fail straight away
+    EXPECT_EQ(ring.read(buffer, sizeof(buffer)), 0u);
+    EXPECT_FALSE(ring.write("x"));
+}
+
+// Feeds `text` split at every position and returns the values of each run, dumped
+static std::vector<std::vector<std::string>> streamAtEverySplit(const std::string& text, bool unwrap) {
+    std::vector<std::vector<std::string>> runs;
+    for (size_t split = 0; split <= text.size(); ++split) {
+        std::vector<std::string> values;
+        HttpJsonStreamSink sink([&values](nlohmann::json&& value) {
+            values.push_back(value.dump());
+            return true;
+        }, unwrap);
+        EXPECT_TRUE(sink.write(std::string_view(text).substr(0, split)));
+        EXPECT_TRUE(sink.write(std::string_view(text).substr(split)));
+        EXPECT_TRUE(sink.finish()) << sink.getError();
+        EXPECT_EQ(sink.getValueCount(), values.size());
+        runs.push_back(values);
+    }
+    return runs;
+}
+
+TEST(HttpJsonStreamSinkTest, SplitsNewlineDelimitedValuesAcrossChunks) {
+    const std::string text = "{\"a\":\"}\\n\"}\n[1,[2]]\r\n\"x\\\"y\"\n-4.5\n\ntrue";
+    const std::vector<std::string> expected = {"{\"a\":\"}\\n\"}", "[1,[2]]", "\"x\\\"y\"", "-4.5", "true"};
+    for (const auto& values : streamAtEverySplit(text, true)) {
+        ASSERT_EQ(values, expected);
+    }
+}
+
+TEST(HttpJsonStreamSinkTest, UnwrapsATopLevelArrayAcrossChunks) {
+    const std::string text = "[ {\"a\":\"x]\"}, 2 ,[3,[4]],\"s\\\"]\",null ]";
+    const std::vector<std::string> elements = {"{\"a\":\"x]\"}", "2", "[3,[4]]", "\"s\\\"]\"", "null"};
+    for (const auto& values : streamAtEverySplit(text, true)) {
+        ASSERT_EQ(values, elements);
+    }
+    // Without unwrapping the array arrives as one value
+    for (const auto& values : streamAtEverySplit(text, false)) {
+        ASSERT_EQ(values, std::vector<std::string>{nlohmann::json::parse(text).dump()});
+    }
+}
+
+TEST(HttpJsonStreamSinkTest, ReportsTruncatedAndInvalidStreams) {
+    HttpJsonStreamSink truncated([](nlohmann::json&&) { return true; });
+    EXPECT_TRUE(truncated.write("[1, {\"a\": "));
+    EXPECT_FALSE(truncated.finish());
+    EXPECT_FALSE(truncated.getError().empty());
+
+    HttpJsonStreamSink invalid([](nlohmann::json&&) { return true; });
+    EXPECT_FALSE(invalid.write("{\"a\" 1}\n"));
+    EXPECT_FALSE(invalid.write("{}"));
+
+    size_t seen = 0;
+    HttpJsonStreamSink stopped([&seen](nlohmann::json&&) { return ++seen < 2; });
+    EXPECT_FALSE(stopped.write("1\n2\n3\n"));
+    EXPECT_EQ(seen, 2u);
+}
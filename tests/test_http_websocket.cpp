@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "http_test_server.hpp"
+#include "platform/http_client.hpp"
+#include "platform/http_websocket.hpp"
+#include "platform/state_manager.h"
+
+struct Received {
+    std::string data;
+    bool binary;
+};
+
+class HttpWebSocketTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "http_websocket_test";
+        std::filesystem::create_directories(dir);
+        StateManager::getInstance().setInternalDataPath(dir.string());
+    }
+
+    std::string url() const { return "ws://127.0.0.1:" + std::to_string(m_server.port()) + "/ws"; }
+
+    // Without a dispatcher, batches are delivered on the connection thread
+    HttpWebSocket::MessagesHandler collect() {
+        return [this](const HttpWebSocketBatch& batch) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                m_received.push_back({std::string(batch[i].data), batch[i].binary});
+            }
+            m_changed.notify_all();
+        };
+    }
+
+    bool waitFor(std::function<bool()> condition) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_changed.wait_for(lock, std::chrono::seconds(5), condition);
+    }
+
+    static bool waitUntil(std::function<bool()> condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+    LoopbackHttpServer m_server;
+    HttpClient m_client;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<Received> m_received;
+};
+
+TEST_F(HttpWebSocketTest, EchoesTextAndBinaryMessages) {
+    HttpWebSocketOptions options;
+    options.protocol = "echo";
+    HttpWebSocket socket(m_client, url(), collect(), options);
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+
+    const std::string binary("\x00\x01\xff payload", 11);
+    EXPECT_TRUE(socket.send("hello"));
+    EXPECT_TRUE(socket.sendBinary(binary));
+    EXPECT_TRUE(socket.send(std::string(200000, 'x')));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 3; }));
+    EXPECT_EQ(m_received[0].data, "hello");
+    EXPECT_FALSE(m_received[0].binary);
+    EXPECT_EQ(m_received[1].data, binary);
+    EXPECT_TRUE(m_received[1].binary);
+    EXPECT_EQ(m_received[2].data, std::string(200000, 'x'));
+    EXPECT_EQ(socket.getMessageCount(), 3u);
+}
+
+TEST_F(HttpWebSocketTest, ReassemblesFragmentedMessages) {
+    HttpWebSocket socket(m_client, url(), collect());
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("fragmented 100000"));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 1; }));
+    ASSERT_EQ(m_received[0].data.size(), 100000u);
+    EXPECT_TRUE(m_received[0].binary);
+    for (size_t i = 0; i < m_received[0].data.size(); ++i) {
+        ASSERT_EQ(static_cast<unsigned char>(m_received[0].data[i]), i % 251) << "at " << i;
+    }
+}
+
+TEST_F(HttpWebSocketTest, CoalescesABurstIntoOneMainThreadTask) {
+    std::mutex tasksMutex;
+    std::vector<std::function<void()>> tasks;
+    m_client.setMainThreadDispatcher([&](std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push_back(std::move(task));
+    });
+    std::vector<std::string> messages;
+    size_t batches = 0;
+    HttpWebSocket socket(m_client, url(), [&](const HttpWebSocketBatch& batch) {
+        batches++;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            messages.emplace_back(batch[i].data);
+        }
+    });
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("burst 500"));
+    ASSERT_TRUE(waitUntil([&] { return socket.getMessageCount() == 500; }));
+
+    // The "main thread" hasn't run yet, so everything waits in the one queued task
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        pending.swap(tasks);
+    }
+    ASSERT_EQ(pending.size(), 1u);
+    pending[0]();
+    EXPECT_EQ(batches, 1u);
+    ASSERT_EQ(messages.size(), 500u);
+    for (size_t i = 0; i < messages.size(); ++i) {
+        ASSERT_EQ(messages[i], "message " + std::to_string(i));
+    }
+
+    // The next message is scheduled again, into the recycled buffer
+    ASSERT_TRUE(socket.send("again"));
+    ASSERT_TRUE(waitUntil([&] {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        return !tasks.empty();
+    }));
+    tasks[0]();
+    EXPECT_EQ(messages.back(), "again");
+}
+
+TEST_F(HttpWebSocketTest, AnswersPingsAndReconnectsAfterADrop) {
+    HttpWebSocketOptions options;
+    options.reconnectDelay = std::chrono::milliseconds(20);
+    std::vector<std::string> errors;
+    HttpWebSocket socket(m_client, url(), collect(), options, [&](const std::string& error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        errors.push_back(error);
+    });
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+
+    // The server pings; curl's automatic pong makes it send "pong"
+    ASSERT_TRUE(socket.send("ping"));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 1; }));
+    EXPECT_EQ(m_received[0].data, "pong");
+
+    ASSERT_TRUE(socket.send("drop"));
+    ASSERT_TRUE(waitUntil([&] { return socket.getReconnectCount() == 1 && socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("back"));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 2; }));
+    EXPECT_EQ(m_received[1].data, "back");
+    EXPECT_EQ(m_server.getWebSocketCount(), 2u);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EXPECT_EQ(errors.size(), 1u);
+}
+
+TEST_F(HttpWebSocketTest, DeliversTheLastMessagesBeforeAServerClose) {
+    HttpWebSocketOptions options;
+    options.reconnectDelay = std::chrono::seconds(10); // Nothing else arrives to trigger a delivery
+    HttpWebSocket socket(m_client, url(), collect(), options);
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("last 3"));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 3; }));
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(m_received[i].data, "last " + std::to_string(i));
+    }
+}
+
+TEST_F(HttpWebSocketTest, DropsAMessageCutShortByADisconnect) {
+    HttpWebSocketOptions options;
+    options.reconnectDelay = std::chrono::milliseconds(20);
+    HttpWebSocket socket(m_client, url(), collect(), options);
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("cut 1000"));
+    ASSERT_TRUE(waitUntil([&] { return socket.getReconnectCount() == 1 && socket.isConnected(); }));
+    ASSERT_TRUE(socket.send("fresh"));
+    ASSERT_TRUE(waitFor([&] { return m_received.size() == 1; }));
+    EXPECT_EQ(m_received[0].data, "fresh");
+    EXPECT_FALSE(m_received[0].binary);
+}
+
+TEST_F(HttpWebSocketTest, ReconnectsWhenPongsStopArriving) {
+    HttpWebSocketOptions options;
+    options.pingInterval = std::chrono::milliseconds(100);
+    options.pongTimeout = std::chrono::milliseconds(100);
+    options.reconnectDelay = std::chrono::milliseconds(20);
+    HttpWebSocket socket(m_client, url(), collect(), options);
+    ASSERT_TRUE(waitUntil([&] { return socket.isConnected(); }));
+    // The echo server answers our pings, so a quiet connection stays up
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(socket.getReconnectCount(), 0u);
+    EXPECT_TRUE(socket.isConnected());
+
+    ASSERT_TRUE(socket.send("mute"));
+    ASSERT_TRUE(waitUntil([&] { return socket.getReconnectCount() == 1 && socket.isConnected(); }));
+    EXPECT_EQ(m_server.getWebSocketCount(), 2u);
+
+    auto start = std::chrono::steady_clock::now();
+    socket.close();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_TRUE(socket.isClosed());
+    EXPECT_FALSE(socket.isConnected());
+    EXPECT_FALSE(socket.send("after close"));
+}
+
+TEST_F(HttpWebSocketTest, HandlersCanCloseWithoutADispatcher) {
+    // Both handlers run on the connection thread, which close() cannot join
+    HttpWebSocketOptions options;
+    options.reconnectDelay = std::chrono::milliseconds(20);
+    std::atomic<HttpWebSocket*> current{nullptr};
+    HttpWebSocket messages(m_client, url(),
+        [&](const HttpWebSocketBatch&) {
+            if (HttpWebSocket* self = current.load()) {
+                self->close();
+            }
+        },
+        options);
+    current = &messages;
+    ASSERT_TRUE(waitUntil([&] { return messages.isConnected(); }));
+    ASSERT_TRUE(messages.send("hello"));
+    ASSERT_TRUE(waitUntil([&] { return messages.isClosed() && !messages.isConnected(); }));
+
+    HttpWebSocket errors(m_client, url(), [](const HttpWebSocketBatch&) {}, options,
+                         [&](const std::string&) { errors.close(); });
+    ASSERT_TRUE(waitUntil([&] { return errors.isConnected(); }));
+    ASSERT_TRUE(errors.send("drop"));
+    ASSERT_TRUE(waitUntil([&] { return errors.isClosed(); }));
+    EXPECT_EQ(errors.getReconnectCount(), 0u);
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "allocation_counter.hpp"
+#include "platform/mpmc_queue.hpp"
+#include "platform/worker.hpp"
+
+// Spins until `condition` holds or a generous timeout passes
+template <typename Condition>
+static bool waitFor(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+TEST(WorkerTest, RunsTasksInParallel) {
+    Worker worker(4);
+    EXPECT_EQ(worker.getThreadCount(), 4u);
+
+    // Each task waits for all the others, which only works if they run at once
+    std::atomic<int> started{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; i++) {
+        futures.push_back(worker.postTask([&started]() {
+            started++;
+            if (!waitFor([&started]() { return started.load() == 4; })) {
+                throw std::runtime_error("Tasks did not run concurrently");
+            }
+        }));
+    }
+    for (auto& future : futures) {
+        EXPECT_NO_THROW(future.get());
+    }
+}
+
+TEST(WorkerTest, IdleThreadsStealQueuedTasks) {
+    Worker worker(4);
+    // Tasks posted from a pool thread land on its own queue; the poster then blocks
+    // on them, so they can only complete if another thread steals them
+    std::atomic<int> done{0};
+    worker.postTask([&worker, &done]() {
+        std::vector<std::future<void>> children;
+        for (int i = 0; i < 16; i++) {
+            children.push_back(worker.postTask([&done]() { done++; }));
+        }
+        for (auto& child : children) {
+            child.get();
+        }
+    }).get();
+    EXPECT_EQ(done.load(), 16);
+    EXPECT_GT(worker.getStealCount(), 0u);
+}
+
+TEST(WorkerTest, QueueRunsTasksSeriallyInOrder) {
+    Worker worker(4);
+    Worker::Queue queue;
+    std::vector<int> order;
+    std::atomic<int> running{0};
+    std::atomic<bool> overlapped{false};
+    std::future<void> last;
+    for (int i = 0; i < 500; i++) {
+        last = worker.postTaskOn(queue, [&, i]() {
+            if (running.fetch_add(1) != 0) {
+                overlapped = true;
+            }
+            order.push_back(i);
+            running--;
+        });
+        // Unrelated tasks competing for the same threads
+        worker.postTask([]() { std::this_thread::yield(); });
+    }
+    last.get();
+    EXPECT_FALSE(overlapped.load());
+    ASSERT_EQ(order.size(), 500u);
+    for (int i = 0; i < 500; i++) {
+        EXPECT_EQ(order[i], i);
+    }
+}
+
+TEST(WorkerTest, ReportsExceptionsAndFinishesQueuedTasks) {
+    std::atomic<int> done{0};
+    {
+        Worker worker(2);
+        EXPECT_THROW(worker.postTask([]() { throw std::runtime_error("boom"); }).get(), std::runtime_error);
+        Worker::Queue queue;
+        for (int i = 0; i < 100; i++) {
+            worker.postTaskOn(queue, [&done]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                done++;
+            });
+        }
+    }
+    EXPECT_EQ(done.load(), 100);
+}
+
+TEST(WorkerTaskTest, SmallCallablesStayInline) {
+    int calls = 0;
+    auto shared = std::make_shared<int>(7);
+    const uint64_t before = getThreadAllocationCount();
+    WorkerTask task([&calls, shared]() { calls += *shared; });
+    WorkerTask moved = std::move(task);
+    WorkerTaskRing ring;
+    ring.pushBack(std::move(moved));
+    const uint64_t ringAllocations = getThreadAllocationCount() - before;
+    WorkerTask popped = ring.popFront();
+    popped();
+    EXPECT_EQ(calls, 7);
+    EXPECT_TRUE(popped.isInline());
+    EXPECT_FALSE(task);
+    // The only allocation is the ring's first block of slots
+    EXPECT_EQ(ringAllocations, 1u);
+    EXPECT_EQ(getThreadAllocationCount() - before, 1u);
+
+    std::array<char, WorkerTask::kInlineSize + 1> large{};
+    WorkerTask big([large, &calls]() { calls += large[0] + 1; });
+    EXPECT_FALSE(big.isInline());
+    big();
+    EXPECT_EQ(calls, 8);
+    popped.reset();
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(WorkerTaskTest, PostRunsWithoutFutures) {
+    Worker worker(2);
+    Worker::Queue queue;
+    std::atomic<int> done{0};
+    // A throwing task is logged and doesn't take its thread down
+    worker.post([]() { throw std::runtime_error("ignored"); });
+    for (int i = 0; i < 100; i++) {
+        worker.post([&done]() { done++; });
+        worker.postOn(queue, [&done]() { done++; });
+    }
+    EXPECT_TRUE(waitFor([&done]() { return done.load() == 200; }));
+
+    // Rejected when posted instead of crashing the thread that would run it
+    WorkerTask task([&done]() { done++; });
+    WorkerTask moved = std::move(task);
+    EXPECT_THROW(worker.post(std::move(task)), std::runtime_error);
+    EXPECT_THROW(worker.postOn(queue, WorkerTask()), std::runtime_error);
+    worker.post(std::move(moved));
+    EXPECT_TRUE(waitFor([&done]() { return done.load() == 201; }));
+}
+
+TEST(MpmcQueueTest, SpillsIntoOverflowAndKeepsProducerOrder) {
+    MpmcQueue<int> queue(4);
+    EXPECT_EQ(queue.capacity(), 4u);
+    for (int i = 0; i < 10; i++) {
+        queue.push(i);
+    }
+    EXPECT_EQ(queue.getOverflowCount(), 6u);
+    int value = -1;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    // The ring has room again, but the overflow is not empty yet
+    queue.push(10);
+    for (int i = 3; i <= 10; i++) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+}
+
+TEST(MpmcQueueTest, WarmedUpOverflowAllocatesNothing) {
+    MpmcQueue<int> queue(4);
+    int value = 0;
+    for (int round = 0; round < 2; round++) {
+        const uint64_t before = getThreadAllocationCount();
+        for (int i = 0; i < 20; i++) {
+            queue.push(i);
+        }
+        while (queue.tryPop(value)) {
+        }
+        if (round == 1) {
+            EXPECT_EQ(getThreadAllocationCount() - before, 0u);
+        }
+    }
+}
+
+TEST(MpmcQueueTest, DeliversEveryItemOnceUnderContention) {
+    constexpr int kProducers = 4;
+    constexpr int kConsumers = 4;
+    constexpr int kPerProducer = 50000;
+    MpmcQueue<int> queue(64); // Small enough to overflow now and then
+    std::vector<std::atomic<int>> seen(kProducers * kPerProducer);
+    std::atomic<int> consumed{0};
+    std::atomic<bool> outOfOrder{false};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; p++) {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < kPerProducer; i++) {
+                queue.push(p * kPerProducer + i);
+            }
+        });
+    }
+    for (int c = 0; c < kConsumers; c++) {
+        threads.emplace_back([&]() {
+            // Items of one producer reach one consumer in the order they were pushed
+            std::vector<int> last(kProducers, -1);
+            int value = 0;
+            while (consumed.load() < kProducers * kPerProducer) {
+                if (!queue.tryPop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                seen[value]++;
+                int& previous = last[value / kPerProducer];
+                if (value <= previous) {
+                    outOfOrder = true;
+                }
+                previous = value;
+                consumed++;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const auto& count : seen) {
+        ASSERT_EQ(count.load(), 1);
+    }
+    EXPECT_FALSE(outOfOrder.load());
+}